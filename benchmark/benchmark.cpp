@@ -0,0 +1,725 @@
+// headless pathfinding benchmark; loads a map, runs seeded query sets through every selected algorithm
+// and reports latency percentiles and search effort as JSON or CSV.
+//
+//   PathfindingBenchmark <map.osm> [options]
+//     --cache <file>        binary graph cache to load/write alongside the OSM file
+//     --queries <n>         random query pairs (default 1000)
+//     --rank-sources <n>    sources for the Dijkstra-rank query sets (default 20, 0 disables them)
+//     --seed <n>            random seed (default 1)
+//     --algorithms <a,b,..> subset to run (default: everything except the Bellman-Ford variants)
+//     --threads <n>         worker threads for the parallel algorithms (default: hardware concurrency)
+//     --checked on|off      record checked edges like the visualizer does (default off)
+//     --profiles <file>     traffic profile file for the time-dependent algorithms (default: free flow everywhere)
+//     --departure <s>       departure time of the time-dependent algorithms, seconds since midnight (default 28800)
+//     --landmarks <n>       landmarks of the ALT algorithms (default 16)
+//     --alternatives <n>    routes besides the shortest one for the alternative route algorithms (default 3)
+//     --hl-resolution <r>   distance resolution of the compressed hub labels, 0 for exact (default 0)
+//     --isochrone-limit <d> isochrones of this distance around random sources, by every method (default 0, off)
+//     --feed <file>         replay a traffic feed after the query sets, timing dynamic tree repair against a rebuild
+//     --verify on|off       check the weight of every path against Dijkstra's for the same queries (default off);
+//                           mismatches are reported per result and make the exit status nonzero
+//     --format json|csv     output format (default json)
+//     --output <file>       write results to a file instead of stdout
+//
+// the JSON output also describes the cell partition the graph is numbered by, and how local its edges are,
+// and the turn tables of the edge-based searches
+
+#include "MapGraph.h"
+#include "pathfinding.h"
+#include "ContractionHierarchy.h"
+#include "CustomizableRoutePlanning.h"
+#include "DynamicShortestPathTree.h"
+#include "HubLabels.h"
+#include "Isochrones.h"
+#include "Landmarks.h"
+#include "ThreadPool.h"
+#include "TrafficFeed.h"
+#include "TrafficProfiles.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+    struct Query {
+        uint32_t from;
+        uint32_t to;
+    };
+
+    // a named list of queries; rank is the Dijkstra rank exponent for rank sets, -1 for random sets
+    struct QuerySet {
+        std::string name;
+        int rank;
+        std::vector<Query> queries;
+    };
+
+    struct Algorithm {
+        std::string name;
+        std::function<PathfindingSolution(Node*, Node*)> run;
+        bool exact = true; // paths are shortest by edge weight, so --verify can hold them to Dijkstra's
+    };
+
+    struct Result {
+        std::string algorithm;
+        std::string querySet;
+        int rank;
+        size_t queries;
+        size_t unreachable;
+        long long p50;
+        long long p90;
+        long long p99;
+        long long max;
+        double mean;
+        double meanCallNanoseconds; // including building the path, and checked edges with --checked on
+        double meanSettledNodes;
+        double meanRelaxedEdges;
+        long long mismatches = -1; // paths whose weight differs from Dijkstra's; -1 if not verified
+    };
+
+    // MapGraph's cells, and how close the endpoints of its edges are in memory
+    struct PartitionStats {
+        size_t cells;
+        size_t minCellNodes;
+        size_t maxCellNodes;
+        double meanCellNodes;
+        size_t boundaryNodes;
+        size_t maxCellBoundaryNodes;
+        size_t cutEdges;           // edges between two cells
+        double meanLog2IdGap;      // mean over edges of log2(1 + |from - to|)
+        double localityScore;      // 1 - meanLog2IdGap / log2(nodes): 1 when every edge joins neighbouring ids
+    };
+
+    // MapGraph's turn tables
+    struct TurnStats {
+        size_t turns;          // pairs of incoming and outgoing edge, the size of the tables if none were shared
+        size_t tableBytes;     // size with equal tables shared
+        size_t forbiddenTurns; // turns closed by restrictions
+    };
+
+    struct Options {
+        std::string map{};
+        std::string cache{};
+        size_t queries = 1000;
+        size_t rankSources = 20;
+        uint64_t seed = 1;
+        std::vector<std::string> algorithms{};
+        size_t threads = 0;
+        bool recordChecked = false;
+        std::string profiles{};
+        double departure = 8 * 3600.0;
+        size_t landmarks = Landmarks::DEFAULT_COUNT;
+        double hubLabelResolution = 0.0;
+        size_t alternatives = 3;
+        double isochroneLimit = 0.0;
+        std::string feed{};
+        bool verify = false;
+        std::string format = "json";
+        std::string output{};
+    };
+
+    size_t peakMemoryBytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.PeakWorkingSetSize;
+        return 0;
+#else
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+    std::vector<std::string> split(const std::string& list) {
+        std::vector<std::string> items{};
+        std::stringstream stream{ list };
+        std::string item{};
+        while (std::getline(stream, item, ','))
+            if (!item.empty()) items.push_back(item);
+        return items;
+    }
+
+    Options parseOptions(int argc, char** argv) {
+        if (argc < 2)
+            throw std::runtime_error("usage: PathfindingBenchmark <map.osm> [--cache file] [--queries n] [--rank-sources n] [--seed n] "
+                "[--algorithms a,b] [--threads n] [--checked on|off] [--profiles file] [--departure s] [--landmarks n] [--alternatives n] [--hl-resolution r] [--isochrone-limit d] [--feed file] [--verify on|off] [--format json|csv] [--output file]");
+
+        Options options{};
+        options.map = argv[1];
+        for (int i = 2; i < argc; i++) {
+            const std::string flag = argv[i];
+            if (i + 1 >= argc)
+                throw std::runtime_error("missing value for " + flag);
+            const std::string value = argv[++i];
+            if (flag == "--cache") options.cache = value;
+            else if (flag == "--queries") options.queries = std::stoull(value);
+            else if (flag == "--rank-sources") options.rankSources = std::stoull(value);
+            else if (flag == "--seed") options.seed = std::stoull(value);
+            else if (flag == "--algorithms") options.algorithms = split(value);
+            else if (flag == "--threads") options.threads = std::stoull(value);
+            else if (flag == "--checked") options.recordChecked = value == "on";
+            else if (flag == "--profiles") options.profiles = value;
+            else if (flag == "--departure") options.departure = std::stod(value);
+            else if (flag == "--landmarks") options.landmarks = std::stoull(value);
+            else if (flag == "--alternatives") options.alternatives = std::stoull(value);
+            else if (flag == "--hl-resolution") options.hubLabelResolution = std::stod(value);
+            else if (flag == "--isochrone-limit") options.isochroneLimit = std::stod(value);
+            else if (flag == "--feed") options.feed = value;
+            else if (flag == "--verify") options.verify = value == "on";
+            else if (flag == "--format") options.format = value;
+            else if (flag == "--output") options.output = value;
+            else throw std::runtime_error("unknown option " + flag);
+        }
+        if (options.format != "json" && options.format != "csv")
+            throw std::runtime_error("format must be json or csv");
+        return options;
+    }
+
+    QuerySet randomQueries(MapGraph& graph, size_t count, std::mt19937_64& rng) {
+        QuerySet set{ "random", -1, {} };
+        std::uniform_int_distribution<uint32_t> node{ 0, static_cast<uint32_t>(graph.nodeCount() - 1) };
+        for (size_t i = 0; i < count; i++)
+            set.queries.push_back({ node(rng), node(rng) });
+        return set;
+    }
+
+    // for random sources s, the target of rank r is the 2^r-th node Dijkstra would settle from s.
+    // rank sets separate local from long-distance queries, which random pairs almost never are.
+    std::vector<QuerySet> rankQueries(MapGraph& graph, size_t sources, std::mt19937_64& rng, ThreadPool& pool) {
+        std::vector<QuerySet> sets{};
+        std::uniform_int_distribution<uint32_t> node{ 0, static_cast<uint32_t>(graph.nodeCount() - 1) };
+        for (size_t i = 0; i < sources; i++) {
+            const uint32_t source = node(rng);
+            const ShortestPathTree tree = pathfinding::deltaSteppingTree(graph, source, pool);
+
+            // settle order is distance order
+            std::vector<uint32_t> order{};
+            for (uint32_t v = 0; v < graph.nodeCount(); v++) {
+                if (tree.distance[v] != DBL_MAX)
+                    order.push_back(v);
+            }
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return tree.distance[a] < tree.distance[b]; });
+
+            for (int rank = 1; (size_t{ 1 } << rank) < order.size(); rank++) {
+                if (sets.size() < static_cast<size_t>(rank))
+                    sets.push_back({ "rank", rank, {} });
+                sets[rank - 1].queries.push_back({ source, order[size_t{ 1 } << rank] });
+            }
+        }
+        return sets;
+    }
+
+    long long nanosecondsSince(std::chrono::steady_clock::time_point begin) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    long long percentile(const std::vector<long long>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        const size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    // per-query measurements of one algorithm on one query set
+    struct Samples {
+        std::vector<long long> latencies{};
+        double callTotal = 0.0;
+        double settledTotal = 0.0;
+        double relaxedTotal = 0.0;
+        size_t unreachable = 0;
+
+        void add(const SearchStats& stats, long long callNanoseconds, bool reachable) {
+            latencies.push_back(stats.nanoseconds);
+            callTotal += static_cast<double>(callNanoseconds);
+            settledTotal += static_cast<double>(stats.settledNodes);
+            relaxedTotal += static_cast<double>(stats.relaxedEdges);
+            if (!reachable)
+                unreachable++;
+        }
+
+        void add(const PathfindingSolution& solution, long long callNanoseconds, bool reachable) {
+            add(solution.stats, callNanoseconds, reachable);
+        }
+
+        Result summarize(const std::string& algorithm, const std::string& querySet, int rank) {
+            std::sort(latencies.begin(), latencies.end());
+            const double count = std::max<double>(1.0, static_cast<double>(latencies.size()));
+            double latencyTotal = 0.0;
+            for (long long latency : latencies)
+                latencyTotal += static_cast<double>(latency);
+
+            return { algorithm, querySet, rank, latencies.size(), unreachable,
+                percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99), latencies.empty() ? 0 : latencies.back(),
+                latencyTotal / count, callTotal / count, settledTotal / count, relaxedTotal / count };
+        }
+    };
+
+    // weight of a path from "from" to "to"; DBL_MAX if there is none, NAN if its edges do not lead from one to the other
+    double pathWeight(const std::vector<Edge*>& path, Node* from, Node* to) {
+        if (path.empty()) return from == to ? 0.0 : DBL_MAX;
+        double weight = 0.0;
+        Node* current = from;
+        for (const Edge* edge : path) {
+            if (edge->from != current) return NAN;
+            weight += edge->weight;
+            current = edge->to;
+        }
+        return current == to ? weight : NAN;
+    }
+
+    // Dijkstra's path weight for every query of a set, the reference of --verify
+    std::vector<double> referenceWeights(MapGraph& graph, const QuerySet& set) {
+        PathfindingOptions options{};
+        options.stopAtTarget = true;
+        std::vector<double> weights{};
+        weights.reserve(set.queries.size());
+        for (const Query& query : set.queries) {
+            Node* from = graph.nodes[query.from];
+            Node* to = graph.nodes[query.to];
+            weights.push_back(pathWeight(pathfinding::dijkstra(graph, from, to, options).path, from, to));
+        }
+        return weights;
+    }
+
+    bool sameWeight(double weight, double reference) {
+        if (weight == DBL_MAX || reference == DBL_MAX) return weight == reference;
+        return std::fabs(weight - reference) <= 1e-9 * std::max(1.0, reference);
+    }
+
+    // at most this many mismatches of one result are printed
+    constexpr long long REPORTED_MISMATCHES = 10;
+
+    // times the queries of a set. with reference weights, the path of every query is checked against them
+    // outside the timed call
+    Result runQuerySet(MapGraph& graph, const Algorithm& algorithm, const QuerySet& set, const std::vector<double>* reference) {
+        Samples samples{};
+        samples.latencies.reserve(set.queries.size());
+        long long mismatches = 0;
+
+        for (size_t i = 0; i < set.queries.size(); i++) {
+            const Query& query = set.queries[i];
+            Node* from = graph.nodes[query.from];
+            Node* to = graph.nodes[query.to];
+            const auto begin = std::chrono::steady_clock::now();
+            const PathfindingSolution solution = algorithm.run(from, to);
+            const auto end = std::chrono::steady_clock::now();
+            samples.add(solution, std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(),
+                !solution.path.empty() || query.from == query.to);
+
+            if (!reference) continue;
+            const double weight = pathWeight(solution.path, from, to);
+            if (sameWeight(weight, (*reference)[i])) continue;
+            if (++mismatches <= REPORTED_MISMATCHES) {
+                std::cerr << "mismatch: " << algorithm.name << " " << set.name << (set.rank >= 0 ? " " + std::to_string(set.rank) : "")
+                    << " query " << query.from << " -> " << query.to << ": weight " << weight << ", dijkstra " << (*reference)[i] << "\n";
+            }
+        }
+
+        Result result = samples.summarize(algorithm.name, set.name, set.rank);
+        if (reference)
+            result.mismatches = mismatches;
+        return result;
+    }
+
+    // isochrones around the sources of the first ISOCHRONE_SOURCES queries of a set, by every method. the call
+    // time includes the reached edges and outlines; batched sweeps charge each isochrone an equal share of theirs
+    constexpr size_t ISOCHRONE_SOURCES = 64;
+
+    std::vector<Result> runIsochrones(const Isochrones& isochrones, const QuerySet& set, double limit, ThreadPool& pool) {
+        std::vector<uint32_t> sources{};
+        for (size_t i = 0; i < std::min(ISOCHRONE_SOURCES, set.queries.size()); i++)
+            sources.push_back(set.queries[i].from);
+
+        const std::vector<std::pair<std::string, std::function<Isochrone(uint32_t)>>> methods{
+            { "isochrone", [&](uint32_t source) { return isochrones.compute({ source }, limit); } },
+            { "isochrone-dijkstra", [&](uint32_t source) { return isochrones.boundedDijkstra({ source }, limit); } },
+            { "isochrone-sweep", [&](uint32_t source) { return isochrones.sweep({ source }, limit); } },
+        };
+        std::vector<Result> results{};
+        for (const auto& method : methods) {
+            Samples samples{};
+            for (uint32_t source : sources) {
+                const auto begin = std::chrono::steady_clock::now();
+                const Isochrone isochrone = method.second(source);
+                samples.add(isochrone.stats, nanosecondsSince(begin), true);
+            }
+            results.push_back(samples.summarize(method.first, "isochrone", -1));
+        }
+
+        Samples batched{};
+        const auto begin = std::chrono::steady_clock::now();
+        const std::vector<Isochrone> each = isochrones.computeEach(sources, limit, pool);
+        const long long share = nanosecondsSince(begin) / static_cast<long long>(std::max<size_t>(sources.size(), 1));
+        for (const Isochrone& isochrone : each)
+            batched.add(isochrone.stats, share, true);
+        results.push_back(batched.summarize("isochrone-sweep-batched", "isochrone", -1));
+        return results;
+    }
+
+    // replays every batch of a traffic feed. after each batch, the trees of the first FEED_TREES queries are
+    // repaired, and for comparison the same trees are built again from scratch. changes the graph's weights
+    constexpr size_t FEED_TREES = 16;
+
+    std::vector<Result> replayFeed(MapGraph& graph, const std::string& path, const QuerySet& set, const PathfindingOptions& options) {
+        std::ifstream input{ path };
+        if (!input)
+            throw std::runtime_error("failed to open traffic feed " + path);
+
+        TrafficFeed feed{ graph };
+        const size_t count = std::min(FEED_TREES, set.queries.size());
+        std::vector<std::unique_ptr<DynamicShortestPathTree>> trees{};
+        for (size_t i = 0; i < count; i++) {
+            trees.push_back(std::make_unique<DynamicShortestPathTree>(graph));
+            trees.back()->build(graph.nodes[set.queries[i].from], graph.nodes[set.queries[i].to], options);
+        }
+
+        Samples repaired{};
+        Samples rebuilt{};
+        DynamicShortestPathTree scratch{ graph };
+        std::vector<WeightUpdate> batch{};
+        while (feed.next(input, batch)) {
+            graph.updateWeights(batch);
+            for (size_t i = 0; i < count; i++) {
+                Node* from = graph.nodes[set.queries[i].from];
+                Node* to = graph.nodes[set.queries[i].to];
+                const bool reachable = from == to || trees[i]->distance(static_cast<uint32_t>(to->id)) != DBL_MAX;
+
+                auto begin = std::chrono::steady_clock::now();
+                PathfindingSolution solution = trees[i]->repair(batch, to, options);
+                repaired.add(solution, nanosecondsSince(begin), reachable);
+
+                begin = std::chrono::steady_clock::now();
+                solution = scratch.build(from, to, options);
+                rebuilt.add(solution, nanosecondsSince(begin), reachable);
+            }
+        }
+        if (feed.skippedLines() > 0)
+            std::cerr << "skipped " << feed.skippedLines() << " malformed traffic feed lines\n";
+
+        return { repaired.summarize("dynamic-repair", "feed", -1), rebuilt.summarize("dynamic-rebuild", "feed", -1) };
+    }
+
+    PartitionStats partitionStats(const MapGraph& graph) {
+        PartitionStats stats{ graph.cellCount(), SIZE_MAX, 0, 0.0, graph.boundaryNodes.size(), 0, 0, 0.0, 0.0 };
+        for (size_t c = 0; c < graph.cellCount(); c++) {
+            const size_t nodes = graph.cellOffsets[c + 1] - graph.cellOffsets[c];
+            stats.minCellNodes = std::min(stats.minCellNodes, nodes);
+            stats.maxCellNodes = std::max(stats.maxCellNodes, nodes);
+            stats.maxCellBoundaryNodes = std::max<size_t>(stats.maxCellBoundaryNodes, graph.boundaryOffsets[c + 1] - graph.boundaryOffsets[c]);
+        }
+        if (stats.cells == 0) stats.minCellNodes = 0;
+        stats.meanCellNodes = stats.cells > 0 ? static_cast<double>(graph.nodeCount()) / stats.cells : 0.0;
+
+        double gaps = 0.0;
+        for (uint32_t slot = 0; slot < graph.edgeCount(); slot++) {
+            const uint32_t from = graph.sources[slot];
+            const uint32_t to = graph.targets[slot];
+            if (graph.nodeCells[from] != graph.nodeCells[to]) stats.cutEdges++;
+            gaps += std::log2(1.0 + (from > to ? from - to : to - from));
+        }
+        if (graph.edgeCount() > 0) {
+            stats.meanLog2IdGap = gaps / graph.edgeCount();
+            stats.localityScore = 1.0 - stats.meanLog2IdGap / std::log2(static_cast<double>(std::max<size_t>(graph.nodeCount(), 2)));
+        }
+        return stats;
+    }
+
+    TurnStats turnStats(const MapGraph& graph) {
+        TurnStats stats{ 0, graph.turnTables.size(), 0 };
+        for (uint32_t v = 0; v < graph.nodeCount(); v++) {
+            for (uint32_t reverseSlot = graph.reverseOffsets[v]; reverseSlot < graph.reverseOffsets[v + 1]; reverseSlot++) {
+                for (uint32_t slot = graph.offsets[v]; slot < graph.offsets[v + 1]; slot++) {
+                    stats.turns++;
+                    if (graph.turn(graph.reverseEdges[reverseSlot], slot) == TurnType::Forbidden) stats.forbiddenTurns++;
+                }
+            }
+        }
+        return stats;
+    }
+
+    std::string escape(const std::string& text) {
+        std::string escaped{};
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped.push_back('\\');
+            escaped.push_back(c);
+        }
+        return escaped;
+    }
+
+    void writeJson(std::ostream& out, const Options& options, MapGraph& graph, const PartitionStats& partition, const TurnStats& turns,
+        long long loadNanoseconds, long long chBuildNanoseconds, long long crpBuildNanoseconds, long long crpCustomizationNanoseconds,
+        long long altBuildNanoseconds, size_t landmarkTableBytes, long long hubLabelBuildNanoseconds, size_t hubLabelEntries, size_t hubLabelBytes,
+        size_t compressedHubLabelBytes, size_t threads, const std::vector<Result>& results) {
+        out << "{\n";
+        out << "  \"map\": \"" << escape(options.map) << "\",\n";
+        out << "  \"nodes\": " << graph.nodeCount() << ",\n";
+        out << "  \"edges\": " << graph.edgeCount() << ",\n";
+        out << "  \"partition\": { \"cells\": " << partition.cells << ", \"minCellNodes\": " << partition.minCellNodes
+            << ", \"meanCellNodes\": " << partition.meanCellNodes << ", \"maxCellNodes\": " << partition.maxCellNodes
+            << ", \"boundaryNodes\": " << partition.boundaryNodes << ", \"maxCellBoundaryNodes\": " << partition.maxCellBoundaryNodes
+            << ", \"cutEdges\": " << partition.cutEdges << ", \"meanLog2IdGap\": " << partition.meanLog2IdGap
+            << ", \"localityScore\": " << partition.localityScore << " },\n";
+        out << "  \"turns\": { \"turns\": " << turns.turns << ", \"tableBytes\": " << turns.tableBytes
+            << ", \"forbiddenTurns\": " << turns.forbiddenTurns << " },\n";
+        out << "  \"seed\": " << options.seed << ",\n";
+        out << "  \"threads\": " << threads << ",\n";
+        out << "  \"recordChecked\": " << (options.recordChecked ? "true" : "false") << ",\n";
+        out << "  \"loadNanoseconds\": " << loadNanoseconds << ",\n";
+        out << "  \"contractionNanoseconds\": " << chBuildNanoseconds << ",\n";
+        out << "  \"crpBuildNanoseconds\": " << crpBuildNanoseconds << ",\n";
+        out << "  \"crpCustomizationNanoseconds\": " << crpCustomizationNanoseconds << ",\n";
+        out << "  \"altBuildNanoseconds\": " << altBuildNanoseconds << ",\n";
+        out << "  \"landmarkTableBytes\": " << landmarkTableBytes << ",\n";
+        out << "  \"hubLabelBuildNanoseconds\": " << hubLabelBuildNanoseconds << ",\n";
+        out << "  \"hubLabelEntries\": " << hubLabelEntries << ",\n";
+        out << "  \"hubLabelBytes\": " << hubLabelBytes << ",\n";
+        out << "  \"compressedHubLabelBytes\": " << compressedHubLabelBytes << ",\n";
+        out << "  \"isochroneLimit\": " << options.isochroneLimit << ",\n";
+        out << "  \"peakMemoryBytes\": " << peakMemoryBytes() << ",\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            out << "    { \"algorithm\": \"" << r.algorithm << "\", \"querySet\": \"" << r.querySet << "\", ";
+            if (r.rank >= 0)
+                out << "\"rank\": " << r.rank << ", ";
+            out << "\"queries\": " << r.queries << ", \"unreachable\": " << r.unreachable << ", "
+                << "\"latencyNanoseconds\": { \"p50\": " << r.p50 << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+                << ", \"max\": " << r.max << ", \"mean\": " << r.mean << " }, "
+                << "\"meanCallNanoseconds\": " << r.meanCallNanoseconds << ", "
+                << "\"meanSettledNodes\": " << r.meanSettledNodes << ", \"meanRelaxedEdges\": " << r.meanRelaxedEdges;
+            if (r.mismatches >= 0)
+                out << ", \"mismatches\": " << r.mismatches;
+            out << " }"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+    void writeCsv(std::ostream& out, const std::vector<Result>& results) {
+        out << "algorithm,query_set,rank,queries,unreachable,p50_ns,p90_ns,p99_ns,max_ns,mean_ns,mean_call_ns,mean_settled_nodes,mean_relaxed_edges,peak_memory_bytes,mismatches\n";
+        const size_t peak = peakMemoryBytes();
+        for (const Result& r : results) {
+            out << r.algorithm << ',' << r.querySet << ',';
+            if (r.rank >= 0) out << r.rank;
+            out << ',' << r.queries << ',' << r.unreachable << ',' << r.p50 << ',' << r.p90 << ',' << r.p99 << ',' << r.max << ','
+                << r.mean << ',' << r.meanCallNanoseconds << ',' << r.meanSettledNodes << ',' << r.meanRelaxedEdges << ',' << peak << ',';
+            if (r.mismatches >= 0) out << r.mismatches;
+            out << '\n';
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        const Options options = parseOptions(argc, argv);
+
+        auto loadBegin = std::chrono::steady_clock::now();
+        std::unique_ptr<MapGraph> graphStorage = options.cache.empty()
+            ? std::make_unique<MapGraph>(options.map.c_str())
+            : std::make_unique<MapGraph>(options.map.c_str(), options.cache.c_str());
+        MapGraph& graph = *graphStorage;
+        const long long loadNanoseconds = nanosecondsSince(loadBegin);
+        if (graph.nodeCount() == 0)
+            throw std::runtime_error("map has no routable nodes");
+        const PartitionStats partition = partitionStats(graph);
+        std::cerr << partition.cells << " cells of " << partition.minCellNodes << "-" << partition.maxCellNodes << " nodes, "
+            << partition.boundaryNodes << " boundary nodes, " << partition.cutEdges << " cut edges, locality score "
+            << partition.localityScore << "\n";
+        const TurnStats turns = turnStats(graph);
+        std::cerr << turns.turns << " turns in " << turns.tableBytes << " bytes of turn tables, " << turns.forbiddenTurns << " forbidden\n";
+
+        TrafficProfiles profiles{};
+        if (!options.profiles.empty() && !profiles.load(options.profiles.c_str()))
+            throw std::runtime_error("failed to load traffic profiles " + options.profiles);
+        profiles.bind(graph);
+
+        ThreadPool pool{ options.threads };
+        std::unique_ptr<ContractionHierarchy> contractionHierarchy{};
+        long long chBuildNanoseconds = 0;
+        std::unique_ptr<CustomizableRoutePlanning> routePlanning{};
+        long long crpBuildNanoseconds = 0;
+        std::unique_ptr<Landmarks> landmarks{};
+        long long altBuildNanoseconds = 0;
+        std::unique_ptr<HubLabels> hubLabels{};
+        std::unique_ptr<CompressedHubLabels> compressedHubLabels{};
+        long long hubLabelBuildNanoseconds = 0;
+
+        PathfindingOptions earlyExit{};
+        earlyExit.stopAtTarget = true;
+        earlyExit.recordChecked = options.recordChecked;
+        PathfindingOptions quaternary = earlyExit;
+        quaternary.queue = pathfinding::QueueType::QuaternaryHeap;
+        PathfindingOptions radix = earlyExit;
+        radix.queue = pathfinding::QueueType::RadixHeap;
+
+        const std::vector<Algorithm> all{
+            { "dijkstra", [&](Node* a, Node* b) { return pathfinding::dijkstra(graph, a, b, earlyExit); } },
+            { "dijkstra-quaternary", [&](Node* a, Node* b) { return pathfinding::dijkstra(graph, a, b, quaternary); } },
+            { "dijkstra-radix", [&](Node* a, Node* b) { return pathfinding::dijkstra(graph, a, b, radix); } },
+            { "bidirectional-dijkstra", [&](Node* a, Node* b) { return pathfinding::bidirectionalDijkstra(graph, a, b, earlyExit); } },
+            { "astar", [&](Node* a, Node* b) { return pathfinding::astar(graph, a, b, earlyExit); } },
+            { "bidirectional-astar", [&](Node* a, Node* b) { return pathfinding::bidirectionalAstar(graph, a, b, earlyExit); } },
+            { "contraction-hierarchies", [&](Node* a, Node* b) { return contractionHierarchy->query(a, b, earlyExit); } },
+            { "customizable-route-planning", [&](Node* a, Node* b) { return routePlanning->query(a, b, earlyExit); } },
+            { "alt", [&](Node* a, Node* b) { return pathfinding::alt(graph, *landmarks, a, b, earlyExit); } },
+            { "bidirectional-alt", [&](Node* a, Node* b) { return pathfinding::bidirectionalAlt(graph, *landmarks, a, b, earlyExit); } },
+            { "hub-labels", [&](Node* a, Node* b) { return hubLabels->query(a, b, earlyExit); } },
+            { "hub-labels-compressed", [&](Node* a, Node* b) { return compressedHubLabels->query(a, b, earlyExit); }, options.hubLabelResolution == 0.0 },
+            { "alternative-routes", [&](Node* a, Node* b) { return pathfinding::alternativeRoutes(graph, a, b, options.alternatives, earlyExit); } },
+            { "k-shortest-paths", [&](Node* a, Node* b) { return pathfinding::kShortestPaths(graph, a, b, options.alternatives + 1, earlyExit); } },
+            { "edge-based-dijkstra", [&](Node* a, Node* b) { return pathfinding::edgeBasedDijkstra(graph, a, b, {}, earlyExit); }, turns.forbiddenTurns == 0 },
+            { "edge-based-astar", [&](Node* a, Node* b) { return pathfinding::edgeBasedAstar(graph, a, b, {}, earlyExit); }, turns.forbiddenTurns == 0 },
+            { "delta-stepping", [&](Node* a, Node* b) { return pathfinding::deltaStepping(graph, a, b, pool, 0.0, earlyExit); } },
+            { "bellman-ford", [&](Node* a, Node* b) { return pathfinding::bellmanford(graph, a, b, earlyExit); } },
+            { "parallel-bellman-ford", [&](Node* a, Node* b) { return pathfinding::parallelBellmanford(graph, a, b, pool, earlyExit); } },
+            { "time-dependent-dijkstra", [&](Node* a, Node* b) { return pathfinding::timeDependentDijkstra(graph, profiles, a, b, options.departure, earlyExit); },
+                profiles.profileCount() == 0 },
+            { "time-dependent-astar", [&](Node* a, Node* b) { return pathfinding::timeDependentAstar(graph, profiles, a, b, options.departure, earlyExit); },
+                profiles.profileCount() == 0 },
+        };
+
+        std::vector<const Algorithm*> selected{};
+        for (const Algorithm& algorithm : all) {
+            const bool slow = algorithm.name == "bellman-ford" || algorithm.name == "parallel-bellman-ford";
+            const bool requested = std::find(options.algorithms.begin(), options.algorithms.end(), algorithm.name) != options.algorithms.end();
+            if (options.algorithms.empty() ? !slow : requested)
+                selected.push_back(&algorithm);
+        }
+        for (const std::string& name : options.algorithms) {
+            if (std::none_of(all.begin(), all.end(), [&](const Algorithm& a) { return a.name == name; }))
+                throw std::runtime_error("unknown algorithm " + name);
+        }
+
+        // preprocessing is timed separately from the queries
+        const bool needsHubLabels = std::any_of(selected.begin(), selected.end(), [](const Algorithm* a) {
+            return a->name == "hub-labels" || a->name == "hub-labels-compressed";
+        });
+        if (needsHubLabels || options.isochroneLimit > 0.0
+            || std::any_of(selected.begin(), selected.end(), [](const Algorithm* a) { return a->name == "contraction-hierarchies"; })) {
+            const auto begin = std::chrono::steady_clock::now();
+            contractionHierarchy = std::make_unique<ContractionHierarchy>(graph);
+            chBuildNanoseconds = nanosecondsSince(begin);
+        }
+        if (std::any_of(selected.begin(), selected.end(), [](const Algorithm* a) { return a->name == "customizable-route-planning"; })) {
+            const auto begin = std::chrono::steady_clock::now();
+            routePlanning = std::make_unique<CustomizableRoutePlanning>(graph, pool);
+            crpBuildNanoseconds = nanosecondsSince(begin);
+        }
+        if (std::any_of(selected.begin(), selected.end(), [](const Algorithm* a) { return a->name == "alt" || a->name == "bidirectional-alt"; })) {
+            const auto begin = std::chrono::steady_clock::now();
+            landmarks = std::make_unique<Landmarks>(graph, pool, options.landmarks);
+            altBuildNanoseconds = nanosecondsSince(begin);
+        }
+        if (needsHubLabels) {
+            // the labels are built on the hierarchy, whose own build is counted above
+            const auto begin = std::chrono::steady_clock::now();
+            hubLabels = std::make_unique<HubLabels>(*contractionHierarchy, pool);
+            compressedHubLabels = std::make_unique<CompressedHubLabels>(*hubLabels, options.hubLabelResolution);
+            hubLabelBuildNanoseconds = nanosecondsSince(begin);
+            std::cerr << hubLabels->entryCount() << " hub label entries, " << hubLabels->memoryBytes() << " bytes, "
+                << compressedHubLabels->memoryBytes() << " bytes compressed\n";
+        }
+
+        // query sets depend only on the seed, so every algorithm and every run sees the same pairs
+        std::mt19937_64 rng{ options.seed };
+        std::vector<QuerySet> sets{};
+        sets.push_back(randomQueries(graph, options.queries, rng));
+        for (QuerySet& set : rankQueries(graph, options.rankSources, rng, pool))
+            sets.push_back(std::move(set));
+
+        // with --verify, searches whose paths are not shortest by edge weight (turn restrictions, traffic profiles,
+        // rounded label distances) are still timed but not checked
+        std::vector<std::vector<double>> references{};
+        if (options.verify) {
+            for (const QuerySet& set : sets)
+                references.push_back(referenceWeights(graph, set));
+        }
+
+        std::vector<Result> results{};
+        long long mismatches = 0;
+        for (const Algorithm* algorithm : selected) {
+            if (options.verify && !algorithm->exact)
+                std::cerr << algorithm->name << " is not verified, its paths are not shortest by edge weight\n";
+            for (size_t i = 0; i < sets.size(); i++) {
+                const QuerySet& set = sets[i];
+                results.push_back(runQuerySet(graph, *algorithm, set, options.verify && algorithm->exact ? &references[i] : nullptr));
+                std::cerr << algorithm->name << " " << set.name << (set.rank >= 0 ? " " + std::to_string(set.rank) : "")
+                    << ": p50 " << results.back().p50 << " ns";
+                if (results.back().mismatches >= 0) {
+                    std::cerr << ", " << results.back().mismatches << " mismatches";
+                    mismatches += results.back().mismatches;
+                }
+                std::cerr << "\n";
+            }
+        }
+
+        if (options.isochroneLimit > 0.0) {
+            const Isochrones isochrones{ graph, *contractionHierarchy };
+            for (Result& result : runIsochrones(isochrones, sets.front(), options.isochroneLimit, pool)) {
+                std::cerr << result.algorithm << " " << result.querySet << ": p50 " << result.p50 << " ns\n";
+                results.push_back(std::move(result));
+            }
+        }
+
+        // last, since it changes the weights every other algorithm ran on
+        if (!options.feed.empty()) {
+            PathfindingOptions feedOptions{};
+            feedOptions.recordChecked = options.recordChecked;
+            for (Result& result : replayFeed(graph, options.feed, sets.front(), feedOptions)) {
+                std::cerr << result.algorithm << " " << result.querySet << ": p50 " << result.p50 << " ns\n";
+                results.push_back(std::move(result));
+            }
+        }
+
+        std::ofstream file{};
+        if (!options.output.empty()) {
+            file.open(options.output);
+            if (!file)
+                throw std::runtime_error("failed to open " + options.output);
+        }
+        std::ostream& out = options.output.empty() ? std::cout : file;
+        if (options.format == "json")
+            writeJson(out, options, graph, partition, turns, loadNanoseconds, chBuildNanoseconds, crpBuildNanoseconds,
+                routePlanning ? routePlanning->customizationNanoseconds() : 0, altBuildNanoseconds, landmarks ? landmarks->tableBytes() : 0,
+                hubLabelBuildNanoseconds, hubLabels ? hubLabels->entryCount() : 0, hubLabels ? hubLabels->memoryBytes() : 0,
+                compressedHubLabels ? compressedHubLabels->memoryBytes() : 0, pool.size(), results);
+        else
+            writeCsv(out, results);
+
+        if (mismatches > 0) {
+            std::cerr << mismatches << " paths differ from Dijkstra's\n";
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,386 @@
+#include "pathfinding.h"
+
+#include "SearchContext.h"
+#include "SearchHelpers.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <set>
+
+namespace {
+    // via-node filters, relative to the length of the shortest path
+    constexpr double MAX_STRETCH = 0.25;      // a route is at most this much longer than the shortest path
+    constexpr double MAX_SHARING = 0.8;       // and shares at most this much with the shortest path and the routes accepted before it
+    constexpr double LOCAL_OPTIMALITY = 0.25; // its stretch of this length around the via node is a shortest path
+    constexpr size_t MAX_VIA_CANDIDATES = 16; // via nodes tested, best first, before giving up
+
+    // the backward tree Yen's spur searches are directed by reaches this much past the shortest path; beyond
+    // it the bound they get is looser
+    constexpr double SPUR_BOUND_STRETCH = 0.25;
+
+    // relative tolerance of the local optimality test, so rounding never rejects a shortest path
+    constexpr double LOCAL_OPTIMALITY_SLACK = 1e-9;
+
+    using pathfinding::currentTimestamp;
+    using pathfinding::currentNanoseconds;
+    using pathfinding::ZeroPotential;
+    using pathfinding::EuclideanPotential;
+
+    struct AnyEdge {
+        bool operator()(uint32_t /*edge*/, uint32_t /*node*/) const { return true; }
+    };
+
+    // one direction of a label-setting search: forward over the CSR arrays, or backward over the reverse
+    // adjacency, whose slots map back to edge ids. the queue lives in the context, so a search that stopped
+    // at its target or distance limit resumes where it left off
+    struct Search {
+        const MapGraph& graph;
+        const uint32_t* offsets;
+        const uint32_t* adjacent;
+        const uint32_t* edgeIds; // nullptr when slots are edge ids
+        SearchContext::Handle context;
+        pathfinding::BinaryHeap& queue;
+        std::vector<uint32_t> order{}; // settled nodes, in the order they were settled
+
+        Search(const MapGraph& graph, bool backward)
+            : graph{ graph },
+            offsets{ backward ? graph.reverseOffsets.data() : graph.offsets.data() },
+            adjacent{ backward ? graph.reverseSources.data() : graph.targets.data() },
+            edgeIds{ backward ? graph.reverseEdges.data() : nullptr },
+            context{ SearchContext::acquire(graph.nodeCount()) }, queue{ context->queue<pathfinding::BinaryHeap>() } {}
+
+        // forgets the previous search; O(1) apart from clearing the settled order
+        void start(uint32_t root, double rootKey) {
+            context->begin(graph.nodeCount());
+            order.clear();
+            context->update(root, 0.0, UINT32_MAX);
+            queue.push(root, rootKey);
+        }
+
+        // settles nodes until "target" is settled (its edges included), the smallest key exceeds limit or the
+        // queue runs dry. allowed(edge, head) filters the edges; the potential must be consistent over those
+        // it allows. scanned edges are recorded in checked the first time "marks" sees them.
+        // returns false if the search was cancelled
+        template <typename Potential, typename Allowed>
+        bool run(uint32_t target, double limit, const Potential& potential, const Allowed& allowed, SearchContext* marks,
+            std::vector<Edge*>* checked, const SearchControl* control, SearchStats& stats) {
+            const double* weights = graph.weights.data();
+            while (!queue.empty() && queue.top().key <= limit) {
+                const pathfinding::QueueEntry top = queue.pop();
+                const uint32_t v = top.node;
+                if (context->settled(v)) continue; // stale entry left behind by lazy deletion
+                context->settle(v);
+                order.push_back(v);
+                stats.settledNodes++;
+                if (control && stats.settledNodes % SearchControl::CHECKPOINT_INTERVAL == 0 && control->checkpoint(checked)) return false;
+
+                stats.relaxedEdges += offsets[v + 1] - offsets[v];
+                const double distV = context->distance(v);
+                for (uint32_t slot = offsets[v]; slot < offsets[v + 1]; slot++) {
+                    const uint32_t w = adjacent[slot];
+                    const uint32_t edge = edgeIds ? edgeIds[slot] : slot;
+                    if (!allowed(edge, w)) continue;
+
+                    // edge relaxation
+                    const double newDist = distV + weights[edge];
+                    if (newDist < context->distance(w)) {
+                        context->update(w, newDist, edge);
+                        queue.push(w, std::max(newDist + potential(w), top.key));
+                    }
+
+                    // record all checked edges
+                    if (checked && marks->markEdge(edge))
+                        checked->push_back(graph.edges[edge]);
+                }
+                if (v == target) break;
+            }
+            return true;
+        }
+    };
+
+    // distance to the root of a backward search that stopped at "limit": a consistent lower bound on the
+    // distance to the root from every node, since the nodes it did not settle are at least "limit" away
+    struct BackwardBound {
+        const SearchContext& context;
+        double limit;
+
+        double operator()(uint32_t node) const { return context.settled(node) ? context.distance(node) : limit; }
+    };
+
+    // edge ids from the root of a forward search to node
+    std::vector<uint32_t> forwardTreePath(const MapGraph& graph, const SearchContext& context, uint32_t root, uint32_t node) {
+        std::vector<uint32_t> path{};
+        for (; node != root; node = graph.sources[path.back()])
+            path.push_back(context.predecessor(node));
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    // edge ids from node to the root of a backward search
+    std::vector<uint32_t> backwardTreePath(const MapGraph& graph, const SearchContext& context, uint32_t root, uint32_t node) {
+        std::vector<uint32_t> path{};
+        for (; node != root; node = graph.targets[path.back()])
+            path.push_back(context.predecessor(node));
+        return path;
+    }
+
+    std::vector<Edge*> toEdges(const MapGraph& graph, const std::vector<uint32_t>& path) {
+        std::vector<Edge*> edges{};
+        edges.reserve(path.size());
+        for (uint32_t edge : path)
+            edges.push_back(graph.edges[edge]);
+        return edges;
+    }
+
+    // a route of Yen's algorithm; it leaves the route it was derived from at edge "deviation"
+    struct Route {
+        std::vector<uint32_t> edges;
+        double length;
+        size_t deviation;
+    };
+
+    bool longer(const Route& a, const Route& b) { return a.length > b.length; }
+}
+
+PathfindingSolution pathfinding::kShortestPaths(MapGraph& graph, Node* from, Node* to, size_t k, const PathfindingOptions& options) {
+    const auto beginTimestamp = currentTimestamp();
+    const uint32_t source = static_cast<uint32_t>(from->id);
+    const uint32_t target = static_cast<uint32_t>(to->id);
+    const double* weights = graph.weights.data();
+
+    // record all checked edges, over every search
+    std::vector<Edge*> checked{};
+    std::vector<Edge*>* recorded = options.recordChecked ? &checked : nullptr;
+    SearchContext::Handle marks = SearchContext::acquire(graph.nodeCount(), options.recordChecked ? graph.edgeCount() : 0);
+
+    SearchStats stats{};
+    const long long beginNanoseconds = currentNanoseconds();
+
+    // distances to "to", which direct every spur search; exact near the shortest path, which is read off them
+    Search tree{ graph, true };
+    tree.start(target, 0.0);
+    bool finished = tree.run(source, DBL_MAX, ZeroPotential{}, AnyEdge{}, marks.get(), recorded, options.control, stats);
+    const SearchContext& treeContext = *tree.context;
+    const double treeLimit = treeContext.settled(source) ? treeContext.distance(source) * (1.0 + SPUR_BOUND_STRETCH) : DBL_MAX;
+    finished = finished && tree.run(UINT32_MAX, treeLimit, ZeroPotential{}, AnyEdge{}, marks.get(), recorded, options.control, stats);
+    const BackwardBound potential{ treeContext, treeLimit };
+
+    std::vector<Route> routes{};
+    if (finished && k > 0 && treeContext.settled(source))
+        routes.push_back({ backwardTreePath(graph, treeContext, target, source), treeContext.distance(source), 0 });
+
+    std::vector<Route> candidates{}; // min-heap on length
+    std::set<std::vector<uint32_t>> known{}; // every route and candidate, so none is found twice
+    if (!routes.empty()) known.insert(routes.front().edges);
+
+    // nodes and edges a spur search may not use are settled and marked in "removed"
+    SearchContext::Handle removed = SearchContext::acquire(graph.nodeCount(), graph.edgeCount());
+    Search spur{ graph, false };
+    const auto allowed = [&](uint32_t edge, uint32_t node) {
+        return !removed->edgeMarked(edge) && !removed->settled(node);
+    };
+    while (finished && !routes.empty() && routes.size() < k) {
+        const Route& last = routes.back();
+        double rootLength = 0.0;
+        for (size_t i = 0; i < last.deviation; i++)
+            rootLength += weights[last.edges[i]];
+
+        // branch off at every node from the deviation on: the nodes before it are off limits, so the route
+        // stays loopless, and so is the next edge of every route sharing the root up to it
+        for (size_t i = last.deviation; i < last.edges.size() && finished; i++) {
+            const uint32_t spurNode = graph.sources[last.edges[i]];
+            removed->begin(graph.nodeCount(), graph.edgeCount());
+            for (size_t j = 0; j < i; j++)
+                removed->settle(graph.sources[last.edges[j]]);
+            for (const Route& route : routes) {
+                if (route.edges.size() > i && std::equal(route.edges.begin(), route.edges.begin() + i, last.edges.begin()))
+                    removed->markEdge(route.edges[i]);
+            }
+
+            spur.start(spurNode, potential(spurNode));
+            finished = spur.run(target, DBL_MAX, potential, allowed, marks.get(), recorded, options.control, stats);
+            if (finished && spur.context->settled(target)) {
+                Route candidate{ std::vector<uint32_t>(last.edges.begin(), last.edges.begin() + i), rootLength + spur.context->distance(target), i };
+                const std::vector<uint32_t> spurPath = forwardTreePath(graph, *spur.context, spurNode, target);
+                candidate.edges.insert(candidate.edges.end(), spurPath.begin(), spurPath.end());
+                if (known.insert(candidate.edges).second) {
+                    candidates.push_back(std::move(candidate));
+                    std::push_heap(candidates.begin(), candidates.end(), longer);
+                }
+            }
+            rootLength += weights[last.edges[i]];
+        }
+        if (candidates.empty()) break;
+
+        std::pop_heap(candidates.begin(), candidates.end(), longer);
+        routes.push_back(std::move(candidates.back()));
+        candidates.pop_back();
+    }
+    stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+    const auto endTimestamp = currentTimestamp();
+
+    if (!finished) return { checked, {}, beginTimestamp, endTimestamp, stats, true };
+
+    if (routes.empty()) return { checked, {}, beginTimestamp, endTimestamp, stats };
+
+    PathfindingSolution solution{ checked, toEdges(graph, routes.front().edges), beginTimestamp, endTimestamp, stats };
+    for (size_t i = 1; i < routes.size(); i++)
+        solution.alternatives.push_back(toEdges(graph, routes[i].edges));
+    return solution;
+}
+
+PathfindingSolution pathfinding::alternativeRoutes(MapGraph& graph, Node* from, Node* to, size_t maxAlternatives, const PathfindingOptions& options) {
+    const auto beginTimestamp = currentTimestamp();
+    const uint32_t source = static_cast<uint32_t>(from->id);
+    const uint32_t target = static_cast<uint32_t>(to->id);
+    const double* weights = graph.weights.data();
+
+    // record all checked edges, over the forward and backward search
+    std::vector<Edge*> checked{};
+    std::vector<Edge*>* recorded = options.recordChecked ? &checked : nullptr;
+    SearchContext::Handle marks = SearchContext::acquire(graph.nodeCount(), options.recordChecked ? graph.edgeCount() : 0);
+
+    SearchStats stats{};
+    const long long beginNanoseconds = currentNanoseconds();
+
+    // every route passes only nodes v with f(v) + b(v) within the stretch bound. the forward search is A*
+    // towards "to": it finds the shortest path, then carries on until f(v) plus the straight-line distance
+    // to "to" passes the bound. the backward search only enters nodes the forward search settled and is
+    // directed by their exact forward distances, so its keys are f(v) + b(v) and it stops at the bound
+    const EuclideanPotential towardsTarget{ graph, target };
+    Search forward{ graph, false };
+    forward.start(source, towardsTarget(source));
+    bool finished = forward.run(target, DBL_MAX, towardsTarget, AnyEdge{}, marks.get(), recorded, options.control, stats);
+    const SearchContext& f = *forward.context;
+    if (!finished || !f.settled(target)) {
+        stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+        return { checked, {}, beginTimestamp, currentTimestamp(), stats, !finished };
+    }
+    const double shortest = f.distance(target);
+    const double limit = shortest * (1.0 + MAX_STRETCH);
+    finished = forward.run(UINT32_MAX, limit, towardsTarget, AnyEdge{}, marks.get(), recorded, options.control, stats);
+
+    Search backward{ graph, true };
+    const auto fromSource = [&](uint32_t node) { return f.distance(node); };
+    const auto forwardSettled = [&](uint32_t /*edge*/, uint32_t node) { return f.settled(node); };
+    backward.start(target, shortest);
+    finished = finished && backward.run(UINT32_MAX, limit, fromSource, forwardSettled, marks.get(), recorded, options.control, stats);
+    const SearchContext& b = *backward.context;
+
+    // a plateau is a path in both trees. behind is the length of the plateau up to a node, ahead the length
+    // from it on; the first is filled in forward settle order and the second in backward settle order, so
+    // the node they extend is always done first, both potentials being consistent. written before being
+    // read, so never cleared
+    thread_local std::vector<double> behind{};
+    thread_local std::vector<double> ahead{};
+    if (behind.size() < graph.nodeCount()) {
+        behind.resize(graph.nodeCount());
+        ahead.resize(graph.nodeCount());
+    }
+    std::vector<std::pair<double, uint32_t>> candidates{};
+    if (finished) {
+        for (uint32_t v : forward.order) {
+            if (!b.settled(v)) continue;
+            const uint32_t edge = f.predecessor(v);
+            const uint32_t u = edge != UINT32_MAX ? graph.sources[edge] : UINT32_MAX;
+            behind[v] = u != UINT32_MAX && b.settled(u) && b.predecessor(u) == edge ? behind[u] + weights[edge] : 0.0;
+        }
+        for (uint32_t v : backward.order) {
+            if (!f.settled(v)) continue;
+            const uint32_t edge = b.predecessor(v);
+            const uint32_t w = edge != UINT32_MAX ? graph.targets[edge] : UINT32_MAX;
+            ahead[v] = w != UINT32_MAX && f.settled(w) && f.predecessor(w) == edge ? ahead[w] + weights[edge] : 0.0;
+        }
+
+        // every node of a plateau gives the same route, so only its last one is a candidate; the best have
+        // a short route with a long plateau
+        for (uint32_t v : forward.order) {
+            if (!b.settled(v) || ahead[v] != 0.0 || f.distance(v) + b.distance(v) > limit) continue;
+            candidates.push_back({ f.distance(v) + b.distance(v) - behind[v], v });
+        }
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    // nodes and edges of the accepted routes are settled and marked in "taken"
+    SearchContext::Handle taken = SearchContext::acquire(graph.nodeCount(), graph.edgeCount());
+    SearchContext::Handle visited = SearchContext::acquire(graph.nodeCount());
+    Search local{ graph, false };
+    const std::vector<uint32_t> shortestPath = forwardTreePath(graph, f, source, target);
+    const auto take = [&](const std::vector<uint32_t>& route) {
+        taken->settle(source);
+        for (uint32_t edge : route) {
+            taken->settle(graph.targets[edge]);
+            taken->markEdge(edge);
+        }
+    };
+    take(shortestPath);
+
+    std::vector<std::vector<uint32_t>> alternatives{};
+    size_t tested = 0;
+    for (const auto& candidate : candidates) {
+        if (alternatives.size() >= maxAlternatives || tested >= MAX_VIA_CANDIDATES) break;
+        const uint32_t via = candidate.second;
+        if (taken->settled(via)) continue; // its route would run along one already taken
+        tested++;
+
+        std::vector<uint32_t> route = forwardTreePath(graph, f, source, via);
+        const size_t viaIndex = route.size();
+        const std::vector<uint32_t> onward = backwardTreePath(graph, b, target, via);
+        route.insert(route.end(), onward.begin(), onward.end());
+
+        // the two halves are shortest paths but may still cross each other
+        visited->begin(graph.nodeCount());
+        visited->settle(source);
+        bool loopless = true;
+        for (uint32_t edge : route) {
+            if (visited->settled(graph.targets[edge])) {
+                loopless = false;
+                break;
+            }
+            visited->settle(graph.targets[edge]);
+        }
+        if (!loopless) continue;
+
+        double shared = 0.0;
+        for (uint32_t edge : route) {
+            if (taken->edgeMarked(edge)) shared += weights[edge];
+        }
+        if (shared > MAX_SHARING * shortest) continue;
+
+        // local optimality (T-test): the stretch reaching LOCAL_OPTIMALITY * shortest to either side of the
+        // via node must be a shortest path, which a search bounded just below its length cannot beat. the
+        // search is A* towards the end of the stretch
+        size_t first = viaIndex, last = viaIndex;
+        double before = 0.0, after = 0.0;
+        while (first > 0 && before < LOCAL_OPTIMALITY * shortest)
+            before += weights[route[--first]];
+        while (last < route.size() && after < LOCAL_OPTIMALITY * shortest)
+            after += weights[route[last++]];
+        if (first < last) {
+            const uint32_t stretchFrom = graph.sources[route[first]];
+            const uint32_t stretchTo = graph.targets[route[last - 1]];
+            const EuclideanPotential towardsEnd{ graph, stretchTo };
+            local.start(stretchFrom, towardsEnd(stretchFrom));
+            if (!local.run(stretchTo, (before + after) * (1.0 - LOCAL_OPTIMALITY_SLACK), towardsEnd, AnyEdge{}, nullptr, nullptr, options.control, stats)) {
+                finished = false;
+                break;
+            }
+            if (local.context->settled(stretchTo)) continue;
+        }
+
+        take(route);
+        alternatives.push_back(std::move(route));
+    }
+    stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+    const auto endTimestamp = currentTimestamp();
+
+    if (!finished) return { checked, {}, beginTimestamp, endTimestamp, stats, true };
+
+    PathfindingSolution solution{ checked, toEdges(graph, shortestPath), beginTimestamp, endTimestamp, stats };
+    for (const std::vector<uint32_t>& route : alternatives)
+        solution.alternatives.push_back(toEdges(graph, route));
+    return solution;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// layout helpers shared by the binary cache files (MapGraph's graph cache and the landmark cache). both
+// pad every array to whole 8 byte words, so the arrays are naturally aligned in a MappedFile, and check
+// their payload with the same hash
+namespace cachefile {
+	inline size_t padded(size_t bytes) {
+		return (bytes + 7) & ~static_cast<size_t>(7);
+	}
+
+	// word-wise hash; the payload is always a whole number of 8 byte words
+	inline uint64_t checksum(const char* data, size_t size) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, data + i, sizeof(word));
+			hash = (hash ^ word) * 0x100000001b3ull;
+			hash ^= hash >> 32;
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,430 @@
+#include "ContractionHierarchy.h"
+
+#include "PriorityQueue.h"
+#include "SearchContext.h"
+#include "SearchHelpers.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+#include <queue>
+
+namespace {
+    // nodes settled by a single witness search before giving up and assuming no witness exists.
+    // missing a witness only costs an unnecessary shortcut, never correctness. priorities are only
+    // estimates and are recomputed with the full limit before a node is contracted, so they get a
+    // much cheaper search
+    constexpr size_t WITNESS_SETTLE_LIMIT = 500;
+    constexpr size_t ESTIMATE_SETTLE_LIMIT = 35;
+
+    // an arc of the remaining graph as seen from one of its ends, with the other end and the weight
+    // inline so searches over the remaining graph never look the arc up
+    struct RemainingArc {
+        uint32_t arc;
+        uint32_t node;
+        double weight;
+    };
+
+    // remaining graph of the contraction: per node its arcs to and from uncontracted nodes, with the
+    // position of every arc in both lists so arcs are removed in constant time
+    class RemainingGraph {
+    public:
+        explicit RemainingGraph(size_t nodeCount) : out(nodeCount), in(nodeCount) {}
+
+        void add(const ContractionHierarchy::Arc& arc, uint32_t arcId) {
+            if (outPosition.size() <= arcId) {
+                outPosition.resize(arcId + 1);
+                inPosition.resize(arcId + 1);
+            }
+            outPosition[arcId] = static_cast<uint32_t>(out[arc.from].size());
+            inPosition[arcId] = static_cast<uint32_t>(in[arc.to].size());
+            out[arc.from].push_back({ arcId, arc.to, arc.weight });
+            in[arc.to].push_back({ arcId, arc.from, arc.weight });
+        }
+
+        void remove(const ContractionHierarchy::Arc& arc, uint32_t arcId) {
+            erase(out[arc.from], outPosition, arcId);
+            erase(in[arc.to], inPosition, arcId);
+        }
+
+        std::vector<std::vector<RemainingArc>> out; // arcs leaving every node, to their heads
+        std::vector<std::vector<RemainingArc>> in;  // arcs entering every node, from their tails
+    private:
+        static void erase(std::vector<RemainingArc>& list, std::vector<uint32_t>& position, uint32_t arcId) {
+            const RemainingArc last = list.back();
+            list[position[arcId]] = last;
+            position[last.arc] = position[arcId];
+            list.pop_back();
+        }
+
+        std::vector<uint32_t> outPosition{};
+        std::vector<uint32_t> inPosition{};
+    };
+
+    // bounded Dijkstra over the remaining graph, used to look for paths that make a shortcut through
+    // the node being contracted unnecessary. it stops once every target is settled
+    class WitnessSearch {
+    public:
+        WitnessSearch(size_t nodeCount) : distance(nodeCount, DBL_MAX), targetStamp(nodeCount, 0) {}
+
+        void run(const RemainingGraph& remaining, size_t settleLimit, uint32_t source, uint32_t ignored, double maxDistance, const std::vector<uint32_t>& targets) {
+            for (uint32_t node : touched)
+                distance[node] = DBL_MAX;
+            touched.clear();
+
+            stamp++;
+            size_t remainingTargets = 0;
+            for (uint32_t target : targets) {
+                if (targetStamp[target] == stamp) continue;
+                targetStamp[target] = stamp;
+                remainingTargets++;
+            }
+
+            heap.reset(distance.size());
+            distance[source] = 0.0;
+            touched.push_back(source);
+            heap.push(source, 0.0);
+
+            size_t settled = 0;
+            while (!heap.empty() && settled < settleLimit) {
+                const pathfinding::QueueEntry top = heap.pop();
+                if (top.key > distance[top.node]) continue;
+                if (top.key > maxDistance) break;
+                settled++;
+                if (targetStamp[top.node] == stamp && --remainingTargets == 0) break;
+
+                for (const RemainingArc& arc : remaining.out[top.node]) {
+                    if (arc.node == ignored) continue;
+
+                    const double newDist = top.key + arc.weight;
+                    if (newDist < distance[arc.node]) {
+                        if (distance[arc.node] == DBL_MAX)
+                            touched.push_back(arc.node);
+                        distance[arc.node] = newDist;
+                        heap.push(arc.node, newDist);
+                    }
+                }
+            }
+        }
+
+        double distanceTo(uint32_t node) const { return distance[node]; }
+    private:
+        std::vector<double> distance;
+        std::vector<uint32_t> targetStamp; // == stamp for the targets of the current search
+        uint32_t stamp = 0;
+        std::vector<uint32_t> touched{};
+        pathfinding::BinaryHeap heap{};
+    };
+}
+
+ContractionHierarchy::ContractionHierarchy(MapGraph& graph) : graph{ graph } {
+    // original edges keep their ids as arc ids so unpacking can index graph.edges directly
+    arcs.reserve(graph.edgeCount() * 2);
+    for (uint32_t u = 0; u < graph.nodeCount(); u++) {
+        for (uint32_t slot = graph.offsets[u]; slot < graph.offsets[u + 1]; slot++)
+            arcs.push_back({ u, graph.targets[slot], graph.weights[slot], slot, NO_ARC });
+    }
+
+    buildSearchGraphs(contract());
+}
+
+std::vector<bool> ContractionHierarchy::contract() {
+    const size_t nodeCount = graph.nodeCount();
+
+    // only the shortest of parallel arcs stays in the remaining graph; the others are superseded and left
+    // out of the search graphs, but stay in arcs since shortcuts may already be made of them
+    RemainingGraph remaining{ nodeCount };
+    std::vector<bool> superseded(arcs.size(), false);
+    auto supersedeParallel = [&](uint32_t from, uint32_t to, double weight) {
+        for (const RemainingArc& arc : remaining.out[from]) {
+            if (arc.node != to) continue;
+            if (arc.weight <= weight) return false;
+            const uint32_t arcId = arc.arc;
+            remaining.remove(arcs[arcId], arcId);
+            superseded[arcId] = true;
+            break;
+        }
+        return true;
+    };
+    for (uint32_t arcId = 0; arcId < arcs.size(); arcId++) {
+        if (supersedeParallel(arcs[arcId].from, arcs[arcId].to, arcs[arcId].weight))
+            remaining.add(arcs[arcId], arcId);
+        else
+            superseded[arcId] = true;
+    }
+
+    WitnessSearch witness{ nodeCount };
+
+    // the shortcuts contracting v would add; they are applied as found, so one search per pop serves both
+    // the priority and the contraction
+    std::vector<uint32_t> heads{};
+    auto simulate = [&](uint32_t v, size_t settleLimit, std::vector<Arc>& shortcuts) {
+        shortcuts.clear();
+        heads.clear();
+        for (const RemainingArc& out : remaining.out[v])
+            heads.push_back(out.node);
+        for (const RemainingArc& in : remaining.in[v]) {
+            const uint32_t u = in.node;
+
+            double maxVia = -1.0;
+            for (const RemainingArc& out : remaining.out[v]) {
+                if (out.node != u)
+                    maxVia = std::max(maxVia, in.weight + out.weight);
+            }
+            if (maxVia < 0.0) continue;
+
+            witness.run(remaining, settleLimit, u, v, maxVia, heads);
+
+            for (const RemainingArc& out : remaining.out[v]) {
+                const double via = in.weight + out.weight;
+                if (out.node != u && witness.distanceTo(out.node) > via)
+                    shortcuts.push_back({ u, out.node, via, in.arc, out.arc });
+            }
+        }
+    };
+
+    // original edges behind every arc, and per node the depth of the hierarchy below it
+    std::vector<uint32_t> hops(arcs.size(), 1);
+    std::vector<uint32_t> depth(nodeCount, 0);
+
+    // edge and hop quotients of the contraction plus depth (Geisberger et al.): contracting nodes that
+    // add few arcs for those they remove, preferring shallow parts of the hierarchy, spreads contraction
+    // evenly over the map and keeps queries short
+    auto priority = [&](uint32_t v, const std::vector<Arc>& shortcuts) {
+        uint32_t removedHops = 0;
+        for (const RemainingArc& arc : remaining.in[v])
+            removedHops += hops[arc.arc];
+        for (const RemainingArc& arc : remaining.out[v])
+            removedHops += hops[arc.arc];
+        uint32_t addedHops = 0;
+        for (const Arc& shortcut : shortcuts)
+            addedHops += hops[shortcut.lower] + hops[shortcut.upper];
+        const size_t removed = remaining.in[v].size() + remaining.out[v].size();
+        return 2.0 * static_cast<double>(shortcuts.size()) / std::max<size_t>(removed, 1)
+            + static_cast<double>(addedHops) / std::max<uint32_t>(removedHops, 1) + depth[v];
+    };
+
+    using Candidate = std::pair<double, uint32_t>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> order{};
+    std::vector<double> priorities(nodeCount);
+    std::vector<Arc> shortcuts{};
+    for (uint32_t v = 0; v < nodeCount; v++) {
+        simulate(v, ESTIMATE_SETTLE_LIMIT, shortcuts);
+        priorities[v] = priority(v, shortcuts);
+        order.push({ priorities[v], v });
+    }
+
+    std::vector<bool> contracted(nodeCount, false);
+    std::vector<uint32_t> neighbors{};
+    rank.assign(nodeCount, 0);
+    uint32_t nextRank = 0;
+    while (!order.empty()) {
+        const Candidate top = order.top();
+        order.pop();
+        const uint32_t v = top.second;
+        if (contracted[v] || top.first != priorities[v]) continue;
+
+        // lazy update; neighbors are updated below, but contractions further away can change the
+        // witness searches too
+        simulate(v, WITNESS_SETTLE_LIMIT, shortcuts);
+        priorities[v] = priority(v, shortcuts);
+        if (!order.empty() && priorities[v] > order.top().first) {
+            order.push({ priorities[v], v });
+            continue;
+        }
+
+        for (const Arc& shortcut : shortcuts) {
+            if (!supersedeParallel(shortcut.from, shortcut.to, shortcut.weight)) continue;
+            arcs.push_back(shortcut);
+            superseded.push_back(false);
+            hops.push_back(hops[shortcut.lower] + hops[shortcut.upper]);
+            remaining.add(shortcut, static_cast<uint32_t>(arcs.size() - 1));
+        }
+        rank[v] = nextRank++;
+        contracted[v] = true;
+
+        // detach v from the remaining graph
+        neighbors.clear();
+        while (!remaining.in[v].empty()) {
+            const RemainingArc arc = remaining.in[v].back();
+            remaining.remove(arcs[arc.arc], arc.arc);
+            neighbors.push_back(arc.node);
+        }
+        while (!remaining.out[v].empty()) {
+            const RemainingArc arc = remaining.out[v].back();
+            remaining.remove(arcs[arc.arc], arc.arc);
+            neighbors.push_back(arc.node);
+        }
+        remaining.in[v].shrink_to_fit();
+        remaining.out[v].shrink_to_fit();
+
+        // the neighbors lost an arc and may have gained shortcuts, so their priorities changed the most
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        for (uint32_t neighbor : neighbors) {
+            depth[neighbor] = std::max(depth[neighbor], depth[v] + 1);
+            simulate(neighbor, ESTIMATE_SETTLE_LIMIT, shortcuts);
+            const double updated = priority(neighbor, shortcuts);
+            if (updated == priorities[neighbor]) continue;
+            priorities[neighbor] = updated;
+            order.push({ updated, neighbor });
+        }
+    }
+    return superseded;
+}
+
+void ContractionHierarchy::buildSearchGraphs(const std::vector<bool>& superseded) {
+    const size_t nodeCount = graph.nodeCount();
+
+    upOffsets.assign(nodeCount + 1, 0);
+    downOffsets.assign(nodeCount + 1, 0);
+    for (uint32_t arcId = 0; arcId < arcs.size(); arcId++) {
+        if (superseded[arcId]) continue;
+        const Arc& arc = arcs[arcId];
+        if (rank[arc.from] < rank[arc.to])
+            upOffsets[arc.from + 1]++;
+        else
+            downOffsets[arc.to + 1]++;
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        upOffsets[i + 1] += upOffsets[i];
+        downOffsets[i + 1] += downOffsets[i];
+    }
+
+    std::vector<uint32_t> upCursor(upOffsets.begin(), upOffsets.end() - 1);
+    std::vector<uint32_t> downCursor(downOffsets.begin(), downOffsets.end() - 1);
+    upArcs.resize(upOffsets.back());
+    downArcs.resize(downOffsets.back());
+    for (uint32_t arcId = 0; arcId < arcs.size(); arcId++) {
+        if (superseded[arcId]) continue;
+        const Arc& arc = arcs[arcId];
+        if (rank[arc.from] < rank[arc.to])
+            upArcs[upCursor[arc.from]++] = arcId;
+        else
+            downArcs[downCursor[arc.to]++] = arcId;
+    }
+}
+
+void ContractionHierarchy::unpack(uint32_t arc, std::vector<Edge*>& edges) const {
+    // explicit stack; shortcuts near the top of the hierarchy can nest very deeply
+    std::vector<uint32_t> stack{ arc };
+    while (!stack.empty()) {
+        const Arc& current = arcs[stack.back()];
+        stack.pop_back();
+        if (current.upper == NO_ARC) {
+            edges.push_back(graph.edges[current.lower]);
+        } else {
+            stack.push_back(current.upper);
+            stack.push_back(current.lower);
+        }
+    }
+}
+
+PathfindingSolution ContractionHierarchy::query(Node* from, Node* to, const PathfindingOptions& options) const {
+    const auto beginTimestamp = pathfinding::currentTimestamp();
+    const long long beginNanoseconds = pathfinding::currentNanoseconds();
+    SearchStats stats{};
+
+    const size_t nodeCount = graph.nodeCount();
+    const uint32_t source = static_cast<uint32_t>(from->id);
+    const uint32_t target = static_cast<uint32_t>(to->id);
+
+    // index 0 is the forward (upward) search, index 1 the backward search over the reversed downward graph
+    // predecessors are arc ids; contexts are reused between queries on this thread
+    // the forward context also marks the original edges recorded as checked
+    const SearchContext::Handle context[2]{ SearchContext::acquire(nodeCount, options.recordChecked ? graph.edgeCount() : 0), SearchContext::acquire(nodeCount) };
+    pathfinding::BinaryHeap* queue[2]{ &context[0]->queue<pathfinding::BinaryHeap>(), &context[1]->queue<pathfinding::BinaryHeap>() };
+    const std::vector<uint32_t>* offsets[2]{ &upOffsets, &downOffsets };
+    const std::vector<uint32_t>* adjacency[2]{ &upArcs, &downArcs };
+
+    context[0]->update(source, 0.0, NO_ARC);
+    context[1]->update(target, 0.0, NO_ARC);
+    queue[0]->push(source, 0.0);
+    queue[1]->push(target, 0.0);
+
+    double best = source == target ? 0.0 : DBL_MAX;
+    uint32_t meeting = source == target ? source : NO_ARC;
+    std::vector<uint32_t> relaxed{};
+
+    // both searches only move upward, so neither may stop at the first meeting; a side is finished
+    // once its queue minimum reaches the best distance found so far
+    while (true) {
+        const bool forwardOpen = !queue[0]->empty() && queue[0]->top().key < best;
+        const bool backwardOpen = !queue[1]->empty() && queue[1]->top().key < best;
+        if (!forwardOpen && !backwardOpen) break;
+
+        const int side = forwardOpen && (!backwardOpen || queue[0]->top().key <= queue[1]->top().key) ? 0 : 1;
+        const pathfinding::QueueEntry top = queue[side]->pop();
+        const uint32_t v = top.node;
+        if (top.key > context[side]->distance(v)) continue;
+        stats.settledNodes++;
+        if (options.control && stats.settledNodes % SearchControl::CHECKPOINT_INTERVAL == 0 && options.control->checkpoint(nullptr)) break;
+
+        const double otherDist = context[1 - side]->distance(v);
+        if (otherDist != DBL_MAX && top.key + otherDist < best) {
+            best = top.key + otherDist;
+            meeting = v;
+        }
+
+        // stall on demand: if a higher ranked node this side has reached offers a shorter way into v, v
+        // is not on any shortest up-down path through this side, and neither is what lies above it
+        bool stalled = false;
+        for (uint32_t i = (*offsets[1 - side])[v]; i < (*offsets[1 - side])[v + 1] && !stalled; i++) {
+            const Arc& arc = arcs[(*adjacency[1 - side])[i]];
+            const double above = context[side]->distance(side == 0 ? arc.from : arc.to);
+            stalled = above != DBL_MAX && above + arc.weight < top.key;
+        }
+        if (stalled) continue;
+        stats.relaxedEdges += (*offsets[side])[v + 1] - (*offsets[side])[v];
+
+        for (uint32_t i = (*offsets[side])[v]; i < (*offsets[side])[v + 1]; i++) {
+            const uint32_t arcId = (*adjacency[side])[i];
+            const Arc& arc = arcs[arcId];
+            const uint32_t w = side == 0 ? arc.to : arc.from;
+            const double newDist = top.key + arc.weight;
+            if (options.recordChecked)
+                relaxed.push_back(arcId);
+
+            if (newDist < context[side]->distance(w)) {
+                context[side]->update(w, newDist, arcId);
+                queue[side]->push(w, newDist);
+            }
+        }
+    }
+
+    if (options.control && options.control->isCancelled()) {
+        stats.nanoseconds = pathfinding::currentNanoseconds() - beginNanoseconds;
+        const auto endTimestamp = pathfinding::currentTimestamp();
+        return { {}, {}, beginTimestamp, endTimestamp, stats, true };
+    }
+
+    // unpack the two halves of the up-down path into original edges
+    std::vector<Edge*> path{};
+    if (meeting != NO_ARC) {
+        std::vector<uint32_t> upward{};
+        for (uint32_t current = meeting; current != source; current = arcs[context[0]->predecessor(current)].from)
+            upward.push_back(context[0]->predecessor(current));
+        for (auto it = upward.rbegin(); it != upward.rend(); ++it)
+            unpack(*it, path);
+        for (uint32_t current = meeting; current != target; current = arcs[context[1]->predecessor(current)].to)
+            unpack(context[1]->predecessor(current), path);
+    }
+
+    const auto endTimestamp = pathfinding::currentTimestamp();
+    stats.nanoseconds = pathfinding::currentNanoseconds() - beginNanoseconds;
+
+    // checked edges are the original edges behind every relaxed arc
+    std::vector<Edge*> checked{};
+    std::vector<Edge*> unpacked{};
+    for (uint32_t arcId : relaxed) {
+        unpacked.clear();
+        unpack(arcId, unpacked);
+        for (Edge* edge : unpacked) {
+            if (context[0]->markEdge(static_cast<uint32_t>(edge->id)))
+                checked.push_back(edge);
+        }
+    }
+
+    return { checked, path, beginTimestamp, endTimestamp, stats };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "MapGraph.h"
+#include "pathfinding.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+// contraction hierarchy over a static MapGraph.
+// preprocessing contracts nodes one at a time in order of importance, adding shortcut arcs whenever
+// a shortest path through the contracted node has no witness path around it. queries then run a
+// bidirectional Dijkstra that only ever moves to higher ranked nodes, stalling nodes that a higher
+// ranked node reaches on a shorter path, and unpack shortcuts back into the original edges so
+// solutions look exactly like those of the plain searches.
+class ContractionHierarchy {
+public:
+	// an original edge (lower == edge id, upper == NO_ARC) or a shortcut made of two arcs
+	struct Arc {
+		uint32_t from;
+		uint32_t to;
+		double weight;
+		uint32_t lower;
+		uint32_t upper;
+	};
+
+	static constexpr uint32_t NO_ARC = UINT32_MAX;
+
+	ContractionHierarchy(MapGraph& graph);
+
+	ContractionHierarchy(const ContractionHierarchy&) = delete;
+	ContractionHierarchy& operator=(const ContractionHierarchy&) = delete;
+
+	// of the options only recordChecked and control apply; checked edges are unpacked after the search, so control sees no progress
+	PathfindingSolution query(Node* from, Node* to, const PathfindingOptions& options = {}) const;
+
+	// appends the original edges of an arc to "edges", in path order
+	void unpack(uint32_t arc, std::vector<Edge*>& edges) const;
+
+	size_t shortcutCount() const { return arcs.size() - graph.edgeCount(); }
+
+	// contraction order; higher ranks were contracted later
+	std::vector<uint32_t> rank;
+
+	// all arcs, original edges first (arc id == edge id) followed by shortcuts
+	std::vector<Arc> arcs;
+
+	// upward graph: arcs u -> w with rank[w] > rank[u], stored at u
+	std::vector<uint32_t> upOffsets;
+	std::vector<uint32_t> upArcs;
+
+	// downward graph reversed: arcs w -> u with rank[w] > rank[u], stored at u for backward searches
+	std::vector<uint32_t> downOffsets;
+	std::vector<uint32_t> downArcs;
+private:
+	// ranks the nodes and adds the shortcuts; returns per arc whether a shorter parallel arc superseded it
+	std::vector<bool> contract();
+	void buildSearchGraphs(const std::vector<bool>& superseded);
+
+	MapGraph& graph;
+};
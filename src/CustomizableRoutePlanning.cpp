@@ -0,0 +1,333 @@
+#include "CustomizableRoutePlanning.h"
+
+#include "PriorityQueue.h"
+#include "SearchContext.h"
+#include "SearchHelpers.h"
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // cells customized per task; a cell runs one search per boundary node, so even one is a sizeable task
+    constexpr size_t CUSTOMIZE_GRAIN = 4;
+}
+
+CustomizableRoutePlanning::CustomizableRoutePlanning(MapGraph& graph, ThreadPool& pool, const std::vector<uint32_t>& maxCellSizes)
+    : graph{ graph }, pool{ pool }, partition{ std::make_shared<const GraphPartition>(graph, maxCellSizes) } {
+    if (graph.nodeCount() >= CLIQUE_ARC || graph.edgeCount() >= CLIQUE_ARC)
+        throw std::runtime_error("graph too large for customizable route planning!");
+
+    // topology: a node is a boundary node of its cell if an edge crosses between it and another cell.
+    // cells nest, so the boundary nodes of a level are also boundary nodes of every level below
+    levels.resize(partition->levelCount());
+    for (size_t l = 0; l < levels.size(); l++) {
+        Level& level = levels[l];
+        level.boundaryIndex.assign(graph.nodeCount(), UINT32_MAX);
+        for (uint32_t slot = 0; slot < graph.edgeCount(); slot++) {
+            const uint32_t u = graph.sources[slot];
+            const uint32_t v = graph.targets[slot];
+            if (partition->cell(l, u) != partition->cell(l, v)) {
+                level.boundaryIndex[u] = 0;
+                level.boundaryIndex[v] = 0;
+            }
+        }
+
+        // group the boundary nodes by cell
+        level.cells.assign(partition->cellCount(l), { 0, 0, 0 });
+        for (uint32_t v = 0; v < graph.nodeCount(); v++) {
+            if (level.boundaryIndex[v] != UINT32_MAX)
+                level.cells[partition->cell(l, v)].boundaryCount++;
+        }
+        uint32_t boundaryBegin = 0;
+        size_t cliqueBegin = 0;
+        for (Cell& cell : level.cells) {
+            cell.boundaryBegin = boundaryBegin;
+            cell.cliqueBegin = cliqueBegin;
+            boundaryBegin += cell.boundaryCount;
+            cliqueBegin += static_cast<size_t>(cell.boundaryCount) * cell.boundaryCount;
+            cell.boundaryCount = 0;
+        }
+        level.boundaryNodes.resize(boundaryBegin);
+        for (uint32_t v = 0; v < graph.nodeCount(); v++) {
+            if (level.boundaryIndex[v] == UINT32_MAX) continue;
+            Cell& cell = level.cells[partition->cell(l, v)];
+            level.boundaryIndex[v] = cell.boundaryCount++;
+            level.boundaryNodes[cell.boundaryBegin + level.boundaryIndex[v]] = v;
+        }
+        level.cliques.assign(cliqueBegin, DBL_MAX);
+        level.arcCounts.assign(boundaryBegin, 0);
+        level.arcTargets.assign(cliqueBegin, 0);
+        level.arcWeights.assign(cliqueBegin, DBL_MAX);
+        level.arcPaths.resize(level.cells.size());
+        level.arcPathBegins.assign(cliqueBegin, 0);
+        level.arcPathEnds.assign(cliqueBegin, 0);
+    }
+
+    customize();
+}
+
+CustomizableRoutePlanning::CustomizableRoutePlanning(const CustomizableRoutePlanning* other)
+    : graph{ other->graph }, pool{ other->pool }, partition{ other->partition }, levels{ other->levels } {
+}
+
+std::unique_ptr<CustomizableRoutePlanning> CustomizableRoutePlanning::recustomized() const {
+    std::unique_ptr<CustomizableRoutePlanning> copy{ new CustomizableRoutePlanning(this) };
+    copy->customize();
+    return copy;
+}
+
+void CustomizableRoutePlanning::customize() {
+    const long long beginNanoseconds = pathfinding::currentNanoseconds();
+
+    // bottom-up, since every level searches the cliques of the one below
+    for (size_t l = 0; l < levels.size(); l++) {
+        Level& level = levels[l];
+        pool.parallelFor(0, level.cells.size(), CUSTOMIZE_GRAIN, [&](size_t begin, size_t end) {
+            SearchContext::Handle context = SearchContext::acquire(graph.nodeCount());
+            std::vector<uint32_t> steps{};
+            std::vector<uint32_t> stepBegins{};
+            for (size_t c = begin; c < end; c++) {
+                const Cell& cell = level.cells[c];
+                steps.clear();
+                stepBegins.clear();
+                for (uint32_t i = 0; i < cell.boundaryCount; i++) {
+                    const uint32_t source = level.boundaryNodes[cell.boundaryBegin + i];
+                    context->begin(graph.nodeCount());
+                    cellSearch(*context, l, source);
+
+                    double* row = &level.cliques[cell.cliqueBegin + static_cast<size_t>(i) * cell.boundaryCount];
+                    for (uint32_t j = 0; j < cell.boundaryCount; j++) {
+                        const uint32_t target = level.boundaryNodes[cell.boundaryBegin + j];
+                        row[j] = context->distance(target);
+
+                        // the path to every boundary node, read off the search tree backwards
+                        stepBegins.push_back(static_cast<uint32_t>(steps.size()));
+                        if (row[j] == DBL_MAX) continue;
+                        for (uint32_t v = target; v != source;) {
+                            const uint32_t predecessor = context->predecessor(v);
+                            steps.push_back(predecessor);
+                            v = predecessor & CLIQUE_ARC ? predecessor & ~CLIQUE_ARC : graph.sources[predecessor];
+                        }
+                        std::reverse(steps.begin() + stepBegins.back(), steps.end());
+                    }
+                }
+                stepBegins.push_back(static_cast<uint32_t>(steps.size()));
+                pruneCell(level, static_cast<uint32_t>(c), steps, stepBegins);
+            }
+        });
+    }
+
+    customizedVersion = graph.weightsVersion();
+    lastCustomizationNanoseconds = pathfinding::currentNanoseconds() - beginNanoseconds;
+}
+
+void CustomizableRoutePlanning::pruneCell(Level& level, uint32_t cellIndex, const std::vector<uint32_t>& steps, const std::vector<uint32_t>& stepBegins) const {
+    const Cell& cell = level.cells[cellIndex];
+    const uint32_t count = cell.boundaryCount;
+    const double* clique = &level.cliques[cell.cliqueBegin];
+    std::vector<uint32_t>& paths = level.arcPaths[cellIndex];
+    paths.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        const size_t row = cell.cliqueBegin + static_cast<size_t>(i) * count;
+        uint32_t arcs = 0;
+        for (uint32_t j = 0; j < count; j++) {
+            const double direct = clique[static_cast<size_t>(i) * count + j];
+            if (j == i || direct == DBL_MAX) continue;
+
+            // detours over a boundary node at positive distance from both ends are strictly shorter arcs,
+            // so replacing arcs by detours always ends at arcs that are kept
+            bool covered = false;
+            for (uint32_t x = 0; x < count && !covered; x++) {
+                const double first = clique[static_cast<size_t>(i) * count + x];
+                if (x == i || x == j || !(first > 0.0 && first < direct)) continue;
+                const double second = clique[static_cast<size_t>(x) * count + j];
+                covered = second > 0.0 && first + second <= direct;
+            }
+            if (covered) continue;
+
+            const size_t entry = static_cast<size_t>(i) * count + j;
+            level.arcTargets[row + arcs] = level.boundaryNodes[cell.boundaryBegin + j];
+            level.arcWeights[row + arcs] = direct;
+            level.arcPathBegins[row + arcs] = static_cast<uint32_t>(paths.size());
+            paths.insert(paths.end(), steps.begin() + stepBegins[entry], steps.begin() + stepBegins[entry + 1]);
+            level.arcPathEnds[row + arcs] = static_cast<uint32_t>(paths.size());
+            arcs++;
+        }
+        level.arcCounts[cell.boundaryBegin + i] = arcs;
+    }
+    paths.shrink_to_fit();
+}
+
+void CustomizableRoutePlanning::cellSearch(SearchContext& context, size_t level, uint32_t source) const {
+    const uint32_t cell = partition->cell(level, source);
+    pathfinding::BinaryHeap& queue = context.queue<pathfinding::BinaryHeap>();
+    context.update(source, 0.0, UINT32_MAX);
+    queue.push(source, 0.0);
+
+    auto relax = [&](uint32_t v, double distance, uint32_t predecessor) {
+        if (distance < context.distance(v)) {
+            context.update(v, distance, predecessor);
+            queue.push(v, distance);
+        }
+    };
+
+    while (!queue.empty()) {
+        const pathfinding::QueueEntry top = queue.pop();
+        const uint32_t u = top.node;
+        if (top.key > context.distance(u)) continue;
+
+        if (level == 0) {
+            for (uint32_t slot = graph.offsets[u]; slot < graph.offsets[u + 1]; slot++) {
+                if (partition->cell(0, graph.targets[slot]) == cell)
+                    relax(graph.targets[slot], top.key + graph.weights[slot], slot);
+            }
+            continue;
+        }
+
+        // every node reached here is a boundary node of its subcell: the source is one a level up, the
+        // others were reached through a clique or over a subcell border
+        const Level& below = levels[level - 1];
+        const uint32_t subcell = partition->cell(level - 1, u);
+        const Cell& sub = below.cells[subcell];
+        assert(below.boundaryIndex[u] != UINT32_MAX);
+        const size_t row = sub.cliqueBegin + static_cast<size_t>(below.boundaryIndex[u]) * sub.boundaryCount;
+        const uint32_t arcs = below.arcCounts[sub.boundaryBegin + below.boundaryIndex[u]];
+        for (size_t a = row; a < row + arcs; a++)
+            relax(below.arcTargets[a], top.key + below.arcWeights[a], CLIQUE_ARC | u);
+        for (uint32_t slot = graph.offsets[u]; slot < graph.offsets[u + 1]; slot++) {
+            const uint32_t v = graph.targets[slot];
+            if (partition->cell(level - 1, v) != subcell && partition->cell(level, v) == cell)
+                relax(v, top.key + graph.weights[slot], slot);
+        }
+    }
+}
+
+void CustomizableRoutePlanning::unpack(size_t level, uint32_t from, uint32_t to, std::vector<Edge*>& edges) const {
+    const Level& overlay = levels[level];
+    const uint32_t cellIndex = partition->cell(level, from);
+    const Cell& cell = overlay.cells[cellIndex];
+    assert(overlay.boundaryIndex[from] != UINT32_MAX);
+    const size_t row = cell.cliqueBegin + static_cast<size_t>(overlay.boundaryIndex[from]) * cell.boundaryCount;
+    const size_t rowEnd = row + overlay.arcCounts[cell.boundaryBegin + overlay.boundaryIndex[from]];
+    size_t a = row;
+    while (a < rowEnd && overlay.arcTargets[a] != to)
+        a++;
+    assert(a < rowEnd);
+
+    // a clique arc step ends where the next step begins, the last one at "to"
+    const std::vector<uint32_t>& steps = overlay.arcPaths[cellIndex];
+    for (uint32_t s = overlay.arcPathBegins[a]; s < overlay.arcPathEnds[a]; s++) {
+        if (!(steps[s] & CLIQUE_ARC)) {
+            edges.push_back(graph.edges[steps[s]]);
+            continue;
+        }
+        uint32_t head = to;
+        if (s + 1 < overlay.arcPathEnds[a])
+            head = steps[s + 1] & CLIQUE_ARC ? steps[s + 1] & ~CLIQUE_ARC : graph.sources[steps[s + 1]];
+        unpack(level - 1, steps[s] & ~CLIQUE_ARC, head, edges);
+    }
+}
+
+size_t CustomizableRoutePlanning::cliqueArcCount() const {
+    size_t count = 0;
+    for (const Level& level : levels) {
+        for (uint32_t arcs : level.arcCounts)
+            count += arcs;
+    }
+    return count;
+}
+
+PathfindingSolution CustomizableRoutePlanning::query(Node* from, Node* to, const PathfindingOptions& options) const {
+    const auto beginTimestamp = pathfinding::currentTimestamp();
+    const long long beginNanoseconds = pathfinding::currentNanoseconds();
+    SearchStats stats{};
+
+    const uint32_t source = static_cast<uint32_t>(from->id);
+    const uint32_t target = static_cast<uint32_t>(to->id);
+    SearchContext::Handle context = SearchContext::acquire(graph.nodeCount());
+    pathfinding::BinaryHeap& queue = context->queue<pathfinding::BinaryHeap>();
+    std::vector<Edge*> checked{};
+    std::vector<Edge*>* record = options.recordChecked ? &checked : nullptr;
+
+    // highest level on which the node's cell contains neither endpoint, or -1 if there is none and the
+    // search has to use the original edges
+    auto queryLevel = [&](uint32_t v) {
+        for (int l = static_cast<int>(levels.size()) - 1; l >= 0; l--) {
+            const uint32_t cell = partition->cell(l, v);
+            if (cell != partition->cell(l, source) && cell != partition->cell(l, target)) return l;
+        }
+        return -1;
+    };
+
+    auto relax = [&](uint32_t v, double distance, uint32_t predecessor) {
+        if (distance < context->distance(v)) {
+            context->update(v, distance, predecessor);
+            queue.push(v, distance);
+        }
+    };
+
+    context->update(source, 0.0, UINT32_MAX);
+    queue.push(source, 0.0);
+    while (!queue.empty()) {
+        const pathfinding::QueueEntry top = queue.pop();
+        const uint32_t u = top.node;
+        if (top.key > context->distance(u)) continue;
+        stats.settledNodes++;
+        if (options.control && stats.settledNodes % SearchControl::CHECKPOINT_INTERVAL == 0 && options.control->checkpoint(record)) break;
+        if (u == target) break;
+
+        // a node reached in a cell without either endpoint is one of its boundary nodes, so it can cross
+        // the cell on the clique and only needs the edges that leave the cell
+        const int level = queryLevel(u);
+        if (level >= 0) {
+            const Level& overlay = levels[level];
+            const Cell& cell = overlay.cells[partition->cell(level, u)];
+            assert(overlay.boundaryIndex[u] != UINT32_MAX);
+            const size_t row = cell.cliqueBegin + static_cast<size_t>(overlay.boundaryIndex[u]) * cell.boundaryCount;
+            const uint32_t arcs = overlay.arcCounts[cell.boundaryBegin + overlay.boundaryIndex[u]];
+            stats.relaxedEdges += arcs;
+            for (size_t a = row; a < row + arcs; a++)
+                relax(overlay.arcTargets[a], top.key + overlay.arcWeights[a], CLIQUE_ARC | u);
+        }
+        for (uint32_t slot = graph.offsets[u]; slot < graph.offsets[u + 1]; slot++) {
+            const uint32_t v = graph.targets[slot];
+            if (level >= 0 && partition->cell(level, v) == partition->cell(level, u)) continue;
+            stats.relaxedEdges++;
+            if (record) record->push_back(graph.edges[slot]);
+            relax(v, top.key + graph.weights[slot], slot);
+        }
+    }
+
+    if (options.control && options.control->isCancelled()) {
+        stats.nanoseconds = pathfinding::currentNanoseconds() - beginNanoseconds;
+        const auto endTimestamp = pathfinding::currentTimestamp();
+        return { checked, {}, beginTimestamp, endTimestamp, stats, true };
+    }
+
+    std::vector<Edge*> path{};
+    if (context->distance(target) != DBL_MAX) {
+        std::vector<std::pair<uint32_t, uint32_t>> arcs{};
+        for (uint32_t v = target; v != source;) {
+            const uint32_t predecessor = context->predecessor(v);
+            arcs.emplace_back(predecessor, v);
+            v = predecessor & CLIQUE_ARC ? predecessor & ~CLIQUE_ARC : graph.sources[predecessor];
+        }
+        for (auto it = arcs.rbegin(); it != arcs.rend(); ++it) {
+            if (it->first & CLIQUE_ARC) {
+                const uint32_t tail = it->first & ~CLIQUE_ARC;
+                unpack(static_cast<size_t>(queryLevel(tail)), tail, it->second, path);
+            } else {
+                path.push_back(graph.edges[it->first]);
+            }
+        }
+    }
+
+    const auto endTimestamp = pathfinding::currentTimestamp();
+    stats.nanoseconds = pathfinding::currentNanoseconds() - beginNanoseconds;
+    return { checked, path, beginTimestamp, endTimestamp, stats };
+}
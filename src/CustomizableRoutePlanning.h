@@ -0,0 +1,101 @@
+#pragma once
+
+#include "GraphPartition.h"
+#include "MapGraph.h"
+#include "pathfinding.h"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class SearchContext;
+class ThreadPool;
+
+// customizable route planning (Delling et al.) over a nested GraphPartition. preprocessing is split in
+// two phases. the topology phase runs once and finds the boundary nodes of every cell, i.e. the nodes
+// with an edge leaving or entering the cell. customization then computes for every cell the distance
+// between each pair of its boundary nodes without leaving the cell (a clique per cell), bottom-up so a
+// level searches the cliques of the level below instead of the edges, and in parallel across the cells
+// of a level. after MapGraph::updateWeights only customize has to run again.
+// queries are a Dijkstra that crosses every cell containing neither endpoint on the clique of the
+// highest such level, and unpack clique arcs back into original edges along the paths customization
+// recorded for them.
+class CustomizableRoutePlanning {
+public:
+	// maxCellSizes is passed on to GraphPartition; runs both preprocessing phases
+	CustomizableRoutePlanning(MapGraph& graph, ThreadPool& pool, const std::vector<uint32_t>& maxCellSizes = { 128, 2048, 32768 });
+
+	CustomizableRoutePlanning(const CustomizableRoutePlanning&) = delete;
+	CustomizableRoutePlanning& operator=(const CustomizableRoutePlanning&) = delete;
+
+	// recomputes every clique from the current weights; nothing may query meanwhile
+	void customize();
+
+	// a new instance sharing this one's topology, customized for the current weights; this one stays
+	// untouched, so queries on it may go on meanwhile
+	std::unique_ptr<CustomizableRoutePlanning> recustomized() const;
+
+	// of the options only recordChecked and control apply; checked holds the original edges the search
+	// scanned, clique arcs are not unpacked for it
+	PathfindingSolution query(Node* from, Node* to, const PathfindingOptions& options = {}) const;
+
+	// false once the weights changed after the last customization
+	bool customized() const { return customizedVersion == graph.weightsVersion(); }
+
+	const GraphPartition& cells() const { return *partition; }
+	size_t boundaryNodeCount(size_t level) const { return levels[level].boundaryNodes.size(); }
+	size_t cliqueArcCount() const; // arcs the searches relax, over all levels
+	long long customizationNanoseconds() const { return lastCustomizationNanoseconds; }
+private:
+	struct Cell {
+		uint32_t boundaryBegin; // into Level::boundaryNodes
+		uint32_t boundaryCount;
+		size_t cliqueBegin;     // boundaryCount x boundaryCount row-major matrix in Level::cliques
+	};
+
+	struct Level {
+		std::vector<Cell> cells;
+		std::vector<uint32_t> boundaryNodes;   // grouped by cell
+		std::vector<uint32_t> boundaryIndex;   // per node, position within its cell's boundary nodes or UINT32_MAX
+		std::vector<double> cliques;
+
+		// the clique arcs searches have to relax, packed at the front of each clique row: an arc that is as
+		// long as a detour over another boundary node of the cell is left to the detour
+		std::vector<uint32_t> arcCounts;  // per boundary node
+		std::vector<uint32_t> arcTargets; // target nodes, laid out like cliques
+		std::vector<double> arcWeights;
+
+		// the path of every clique arc above through the level below, as steps in path order: original edge
+		// ids, or CLIQUE_ARC | the node a clique arc of the level below leaves from
+		std::vector<std::vector<uint32_t>> arcPaths; // per cell, the steps of its arcs one after another
+		std::vector<uint32_t> arcPathBegins;          // into the cell's arcPaths, laid out like arcTargets
+		std::vector<uint32_t> arcPathEnds;
+	};
+
+	// predecessors are original edge ids, or CLIQUE_ARC | the node a clique arc leaves from; the arc's
+	// level follows from the search that recorded it
+	static constexpr uint32_t CLIQUE_ARC = 0x80000000u;
+
+	// Dijkstra from boundary node "source" within its cell of "level", over the level below: the original
+	// edges for level 0, otherwise the cliques of the subcells and the edges between them
+	void cellSearch(SearchContext& context, size_t level, uint32_t source) const;
+
+	// copies the topology of other without customizing
+	explicit CustomizableRoutePlanning(const CustomizableRoutePlanning* other);
+
+	// packs the clique arcs of one cell that are not covered by a detour, together with their paths.
+	// the steps of the path between boundary nodes i and j are steps[stepBegins[i * n + j]] up to
+	// steps[stepBegins[i * n + j + 1]], for n boundary nodes
+	void pruneCell(Level& level, uint32_t cell, const std::vector<uint32_t>& steps, const std::vector<uint32_t>& stepBegins) const;
+
+	// appends the original edges of the clique arc from -> to of "level", in path order
+	void unpack(size_t level, uint32_t from, uint32_t to, std::vector<Edge*>& edges) const;
+
+	MapGraph& graph;
+	ThreadPool& pool;
+	std::shared_ptr<const GraphPartition> partition; // shared with the recustomized instances
+	std::vector<Level> levels{};
+	uint64_t customizedVersion = 0;
+	long long lastCustomizationNanoseconds = 0;
+};
@@ -0,0 +1,220 @@
+#include "DistanceTable.h"
+
+#include "ContractionHierarchy.h"
+#include "SearchContext.h"
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    constexpr size_t DIJKSTRA_GRAIN = 1; // sources per task; every search is a sizable chunk of work
+    constexpr size_t UPWARD_GRAIN = 8;   // upward CH searches are small, so batch a few per task
+
+    // entry left at a node by the upward search of a target
+    struct BucketEntry {
+        uint32_t target; // index into the targets list
+        double distance; // from the bucket node down to the target
+        uint32_t arc;    // first arc of that downward path, NO_ARC at the target itself
+    };
+}
+
+DistanceTable pathfinding::distanceTable(MapGraph& graph, const std::vector<Node*>& sources, const std::vector<Node*>& targets,
+    ThreadPool& pool, bool withPaths) {
+    DistanceTable table{ sources.size(), targets.size(), std::vector<double>(sources.size() * targets.size(), DBL_MAX), {} };
+    if (withPaths)
+        table.paths.resize(sources.size() * targets.size());
+
+    // target indices per node; several targets may share a node
+    std::vector<uint32_t> targetOffsets(graph.nodeCount() + 1, 0);
+    for (Node* target : targets)
+        targetOffsets[target->id + 1]++;
+    size_t distinctTargets = 0;
+    for (size_t i = 0; i < graph.nodeCount(); i++) {
+        if (targetOffsets[i + 1] > 0) distinctTargets++;
+        targetOffsets[i + 1] += targetOffsets[i];
+    }
+    std::vector<uint32_t> cursor(targetOffsets.begin(), targetOffsets.end() - 1);
+    std::vector<uint32_t> targetIndices(targets.size());
+    for (uint32_t j = 0; j < targets.size(); j++)
+        targetIndices[cursor[targets[j]->id]++] = j;
+
+    const uint32_t* offsets = graph.offsets.data();
+    const uint32_t* adjacent = graph.targets.data();
+    const double* weights = graph.weights.data();
+
+    // nodes are numbered cell by cell, so taking the sources in id order has the workers search from the
+    // same cells at the same time, over mostly the same parts of the graph and of the shared cache
+    std::vector<uint32_t> sourceOrder(sources.size());
+    for (uint32_t i = 0; i < sources.size(); i++)
+        sourceOrder[i] = i;
+    std::sort(sourceOrder.begin(), sourceOrder.end(), [&](uint32_t a, uint32_t b) { return sources[a]->id < sources[b]->id; });
+
+    pool.parallelFor(0, sources.size(), DIJKSTRA_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            const size_t i = sourceOrder[k];
+            const SearchContext::Handle search = SearchContext::acquire(graph.nodeCount());
+            BinaryHeap& queue = search->queue<BinaryHeap>();
+
+            double* row = &table.distances[i * targets.size()];
+            const uint32_t source = static_cast<uint32_t>(sources[i]->id);
+            search->update(source, 0.0, UINT32_MAX);
+            queue.push(source, 0.0);
+
+            size_t remaining = distinctTargets;
+            while (!queue.empty() && remaining > 0) {
+                const QueueEntry top = queue.pop();
+                const uint32_t v = top.node;
+                if (search->settled(v)) continue; // stale entry left behind by lazy deletion
+                search->settle(v);
+
+                if (targetOffsets[v] != targetOffsets[v + 1]) {
+                    for (uint32_t t = targetOffsets[v]; t < targetOffsets[v + 1]; t++)
+                        row[targetIndices[t]] = top.key;
+                    remaining--;
+                }
+
+                for (uint32_t slot = offsets[v]; slot < offsets[v + 1]; slot++) {
+                    const double newDist = top.key + weights[slot];
+                    if (newDist < search->distance(adjacent[slot])) {
+                        search->update(adjacent[slot], newDist, slot);
+                        queue.push(adjacent[slot], newDist);
+                    }
+                }
+            }
+
+            if (withPaths) {
+                for (size_t j = 0; j < targets.size(); j++) {
+                    if (row[j] == DBL_MAX) continue;
+                    std::vector<Edge*>& path = table.paths[i * targets.size() + j];
+                    for (uint32_t current = static_cast<uint32_t>(targets[j]->id); current != source; current = graph.sources[search->predecessor(current)])
+                        path.push_back(graph.edges[search->predecessor(current)]);
+                    std::reverse(path.begin(), path.end());
+                }
+            }
+        }
+    });
+
+    return table;
+}
+
+DistanceTable pathfinding::distanceTable(const ContractionHierarchy& hierarchy, const std::vector<Node*>& sources, const std::vector<Node*>& targets,
+    ThreadPool& pool, bool withPaths) {
+    using Arc = ContractionHierarchy::Arc;
+    const uint32_t NO_ARC = ContractionHierarchy::NO_ARC;
+    const size_t nodeCount = hierarchy.rank.size();
+
+    DistanceTable table{ sources.size(), targets.size(), std::vector<double>(sources.size() * targets.size(), DBL_MAX), {} };
+    if (withPaths)
+        table.paths.resize(sources.size() * targets.size());
+
+    // backward phase: the upward search space of every target, over the reversed downward graph
+    std::vector<std::vector<std::pair<uint32_t, BucketEntry>>> reached(targets.size());
+    pool.parallelFor(0, targets.size(), UPWARD_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; j++) {
+            const SearchContext::Handle search = SearchContext::acquire(nodeCount);
+            BinaryHeap& queue = search->queue<BinaryHeap>();
+            search->update(static_cast<uint32_t>(targets[j]->id), 0.0, NO_ARC);
+            queue.push(static_cast<uint32_t>(targets[j]->id), 0.0);
+            while (!queue.empty()) {
+                const QueueEntry top = queue.pop();
+                const uint32_t v = top.node;
+                if (top.key > search->distance(v)) continue;
+                reached[j].push_back({ v, { static_cast<uint32_t>(j), top.key, search->predecessor(v) } });
+
+                for (uint32_t i = hierarchy.downOffsets[v]; i < hierarchy.downOffsets[v + 1]; i++) {
+                    const uint32_t arcId = hierarchy.downArcs[i];
+                    const Arc& arc = hierarchy.arcs[arcId];
+                    const double newDist = top.key + arc.weight;
+                    if (newDist < search->distance(arc.from)) {
+                        search->update(arc.from, newDist, arcId);
+                        queue.push(arc.from, newDist);
+                    }
+                }
+            }
+        }
+    });
+
+    // buckets in CSR form; filling target by target keeps every bucket sorted by target index
+    std::vector<uint32_t> bucketOffsets(nodeCount + 1, 0);
+    for (const auto& space : reached) {
+        for (const auto& entry : space)
+            bucketOffsets[entry.first + 1]++;
+    }
+    for (size_t i = 0; i < nodeCount; i++)
+        bucketOffsets[i + 1] += bucketOffsets[i];
+    std::vector<uint32_t> cursor(bucketOffsets.begin(), bucketOffsets.end() - 1);
+    std::vector<BucketEntry> buckets(bucketOffsets.back());
+    for (auto& space : reached) {
+        for (const auto& entry : space)
+            buckets[cursor[entry.first]++] = entry.second;
+        space.clear();
+        space.shrink_to_fit();
+    }
+
+    // forward phase: every source scans the buckets of its upward search space
+    pool.parallelFor(0, sources.size(), UPWARD_GRAIN, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> meeting(withPaths ? targets.size() : 0);
+
+        for (size_t i = begin; i < end; i++) {
+            const SearchContext::Handle search = SearchContext::acquire(nodeCount);
+            BinaryHeap& queue = search->queue<BinaryHeap>();
+            double* row = &table.distances[i * targets.size()];
+            search->update(static_cast<uint32_t>(sources[i]->id), 0.0, NO_ARC);
+            queue.push(static_cast<uint32_t>(sources[i]->id), 0.0);
+
+            while (!queue.empty()) {
+                const QueueEntry top = queue.pop();
+                const uint32_t v = top.node;
+                if (top.key > search->distance(v)) continue;
+
+                for (uint32_t b = bucketOffsets[v]; b < bucketOffsets[v + 1]; b++) {
+                    const BucketEntry& entry = buckets[b];
+                    if (top.key + entry.distance < row[entry.target]) {
+                        row[entry.target] = top.key + entry.distance;
+                        if (withPaths)
+                            meeting[entry.target] = v;
+                    }
+                }
+
+                for (uint32_t a = hierarchy.upOffsets[v]; a < hierarchy.upOffsets[v + 1]; a++) {
+                    const uint32_t arcId = hierarchy.upArcs[a];
+                    const Arc& arc = hierarchy.arcs[arcId];
+                    const double newDist = top.key + arc.weight;
+                    if (newDist < search->distance(arc.to)) {
+                        search->update(arc.to, newDist, arcId);
+                        queue.push(arc.to, newDist);
+                    }
+                }
+            }
+
+            if (!withPaths) continue;
+
+            std::vector<uint32_t> upward{};
+            for (uint32_t j = 0; j < targets.size(); j++) {
+                if (row[j] == DBL_MAX) continue;
+                std::vector<Edge*>& path = table.paths[i * targets.size() + j];
+
+                // source up to the meeting node through the forward search tree
+                upward.clear();
+                for (uint32_t current = meeting[j]; search->predecessor(current) != NO_ARC; current = hierarchy.arcs[search->predecessor(current)].from)
+                    upward.push_back(search->predecessor(current));
+                for (auto it = upward.rbegin(); it != upward.rend(); ++it)
+                    hierarchy.unpack(*it, path);
+
+                // meeting node down to the target through the target's bucket entries
+                for (uint32_t current = meeting[j]; ; ) {
+                    const BucketEntry* first = buckets.data() + bucketOffsets[current];
+                    const BucketEntry* last = buckets.data() + bucketOffsets[current + 1];
+                    const BucketEntry* entry = std::lower_bound(first, last, j, [](const BucketEntry& e, uint32_t target) { return e.target < target; });
+                    if (entry->arc == NO_ARC) break;
+                    hierarchy.unpack(entry->arc, path);
+                    current = hierarchy.arcs[entry->arc].to;
+                }
+            }
+        }
+    });
+
+    return table;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "MapGraph.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+class ContractionHierarchy;
+class ThreadPool;
+
+// origin x destination cost matrix, stored row-major with one row per source
+struct DistanceTable {
+	size_t sourceCount = 0;
+	size_t targetCount = 0;
+	std::vector<double> distances;         // DBL_MAX when the target cannot be reached
+	std::vector<std::vector<Edge*>> paths; // empty unless paths were requested
+
+	double distance(size_t source, size_t target) const { return distances[source * targetCount + target]; }
+	const std::vector<Edge*>& path(size_t source, size_t target) const { return paths[source * targetCount + target]; }
+};
+
+namespace pathfinding {
+	// one Dijkstra per source, run in parallel across the pool; each search stops as soon as every
+	// target is settled instead of exploring the whole graph
+	DistanceTable distanceTable(MapGraph& graph, const std::vector<Node*>& sources, const std::vector<Node*>& targets,
+		ThreadPool& pool, bool withPaths = false);
+
+	// bucket-based many-to-many over a contraction hierarchy (Knopp et al.). an upward search from every
+	// target leaves (target, distance) entries in buckets at the nodes it reaches; an upward search
+	// from every source then only scans the buckets of the nodes it settles. both phases run in parallel.
+	DistanceTable distanceTable(const ContractionHierarchy& hierarchy, const std::vector<Node*>& sources, const std::vector<Node*>& targets,
+		ThreadPool& pool, bool withPaths = false);
+}
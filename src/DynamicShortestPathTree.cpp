@@ -0,0 +1,155 @@
+#include "DynamicShortestPathTree.h"
+
+#include "SearchContext.h"
+#include "SearchHelpers.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    using pathfinding::currentTimestamp;
+    using pathfinding::currentNanoseconds;
+
+    // a repair that cuts off more than 1 / REBUILD_FRACTION of the nodes recomputes the tree instead
+    constexpr size_t REBUILD_FRACTION = 2;
+}
+
+DynamicShortestPathTree::DynamicShortestPathTree(const MapGraph& graph) : graph{ graph } {}
+
+PathfindingSolution DynamicShortestPathTree::build(Node* source, Node* to, const PathfindingOptions& options) {
+    const auto beginTimestamp = currentTimestamp();
+    const long long beginNanoseconds = currentNanoseconds();
+    std::vector<Edge*> checked{};
+    SearchStats stats{};
+
+    sourceNode = source;
+    weightsVersion = graph.weightsVersion();
+    tree.distance.assign(graph.nodeCount(), DBL_MAX);
+    tree.predecessor.assign(graph.nodeCount(), UINT32_MAX);
+    heap.reset(graph.nodeCount());
+
+    tree.distance[source->id] = 0.0;
+    heap.push(static_cast<uint32_t>(source->id), 0.0);
+    const SearchContext::Handle marks = SearchContext::acquire(graph.nodeCount(), options.recordChecked ? graph.edgeCount() : 0);
+    propagate(options.recordChecked ? &checked : nullptr, marks.get(), stats);
+    stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+    tree.stats = stats;
+
+    std::vector<Edge*> path = pathTo(static_cast<uint32_t>(to->id));
+    return { std::move(checked), std::move(path), beginTimestamp, currentTimestamp(), stats };
+}
+
+PathfindingSolution DynamicShortestPathTree::repair(const std::vector<WeightUpdate>& updates, Node* to, const PathfindingOptions& options) {
+    if (!sourceNode) return route(to);
+    if (graph.weightsVersion() != weightsVersion + 1) return build(sourceNode, to, options);
+    weightsVersion = graph.weightsVersion();
+
+    const auto beginTimestamp = currentTimestamp();
+    const long long beginNanoseconds = currentNanoseconds();
+    std::vector<Edge*> checked{};
+    std::vector<Edge*>* record = options.recordChecked ? &checked : nullptr;
+    // the reattach pass and the propagation can scan the same edge; it is recorded once
+    const SearchContext::Handle marks = SearchContext::acquire(graph.nodeCount(), record ? graph.edgeCount() : 0);
+    SearchStats stats{};
+
+    // tree labels satisfy distance[v] == distance[u] + weight exactly, so a tree edge whose new weight
+    // breaks that got more expensive. everything below it is cut off, found by walking the tree down
+    affected.clear();
+    for (const WeightUpdate& update : updates) {
+        const uint32_t v = graph.targets[update.edge];
+        const uint32_t u = graph.sources[update.edge];
+        if (tree.predecessor[v] != update.edge || tree.distance[u] + graph.weights[update.edge] <= tree.distance[v]) continue;
+        tree.predecessor[v] = UINT32_MAX; // cut, so a second update in the same subtree does not collect it again
+        affected.push_back(v);
+    }
+    for (size_t i = 0; i < affected.size(); i++) {
+        const uint32_t u = affected[i];
+        for (uint32_t slot = graph.offsets[u]; slot < graph.offsets[u + 1]; slot++) {
+            if (tree.predecessor[graph.targets[slot]] == slot)
+                affected.push_back(graph.targets[slot]);
+        }
+    }
+    // reattaching most of the graph costs more than searching it again
+    if (affected.size() > graph.nodeCount() / REBUILD_FRACTION) return build(sourceNode, to, options);
+
+    heap.reset(graph.nodeCount());
+    for (uint32_t v : affected) {
+        tree.distance[v] = DBL_MAX;
+        tree.predecessor[v] = UINT32_MAX;
+    }
+
+    // reattach the cut nodes through their best incoming edge from the rest of the tree
+    for (uint32_t v : affected) {
+        for (uint32_t r = graph.reverseOffsets[v]; r < graph.reverseOffsets[v + 1]; r++) {
+            const uint32_t u = graph.reverseSources[r];
+            const uint32_t slot = graph.reverseEdges[r];
+            if (tree.distance[u] == DBL_MAX) continue;
+            stats.relaxedEdges++;
+            if (record && marks->markEdge(slot)) record->push_back(graph.edges[slot]);
+            const double distance = tree.distance[u] + graph.weights[slot];
+            if (distance < tree.distance[v]) {
+                tree.distance[v] = distance;
+                tree.predecessor[v] = slot;
+            }
+        }
+        if (tree.distance[v] != DBL_MAX)
+            heap.push(v, tree.distance[v]);
+    }
+
+    // cheaper edges can shorten the distance of their head and everything reached through it
+    for (const WeightUpdate& update : updates) {
+        const uint32_t u = graph.sources[update.edge];
+        const uint32_t v = graph.targets[update.edge];
+        if (tree.distance[u] == DBL_MAX) continue;
+        const double distance = tree.distance[u] + graph.weights[update.edge];
+        if (distance < tree.distance[v]) {
+            tree.distance[v] = distance;
+            tree.predecessor[v] = update.edge;
+            heap.push(v, distance);
+        }
+    }
+
+    propagate(record, marks.get(), stats);
+    stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+    std::vector<Edge*> path = pathTo(static_cast<uint32_t>(to->id));
+    return { std::move(checked), std::move(path), beginTimestamp, currentTimestamp(), stats };
+}
+
+PathfindingSolution DynamicShortestPathTree::route(Node* to) const {
+    const auto timestamp = currentTimestamp();
+    return { {}, pathTo(static_cast<uint32_t>(to->id)), timestamp, timestamp, {} };
+}
+
+void DynamicShortestPathTree::propagate(std::vector<Edge*>* checked, SearchContext* marks, SearchStats& stats) {
+    // labels only ever decrease here and every decrease is queued, so the entries that are not stale
+    // come out in distance order and each node is scanned with its final distance
+    while (!heap.empty()) {
+        const pathfinding::QueueEntry entry = heap.pop();
+        const uint32_t u = entry.node;
+        if (entry.key > tree.distance[u]) continue;
+        stats.settledNodes++;
+
+        for (uint32_t slot = graph.offsets[u]; slot < graph.offsets[u + 1]; slot++) {
+            const uint32_t v = graph.targets[slot];
+            stats.relaxedEdges++;
+            if (checked && marks->markEdge(slot)) checked->push_back(graph.edges[slot]);
+            const double distance = entry.key + graph.weights[slot];
+            if (distance < tree.distance[v]) {
+                tree.distance[v] = distance;
+                tree.predecessor[v] = slot;
+                heap.push(v, distance);
+            }
+        }
+    }
+}
+
+std::vector<Edge*> DynamicShortestPathTree::pathTo(uint32_t node) const {
+    std::vector<Edge*> path;
+    if (tree.distance.empty() || tree.distance[node] == DBL_MAX) return path;
+    for (uint32_t v = node; tree.predecessor[v] != UINT32_MAX; v = graph.sources[tree.predecessor[v]])
+        path.push_back(graph.edges[tree.predecessor[v]]);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
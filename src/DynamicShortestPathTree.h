@@ -0,0 +1,55 @@
+#pragma once
+
+#include "MapGraph.h"
+#include "pathfinding.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+class SearchContext;
+
+// one-to-all shortest path tree that follows weight updates instead of being recomputed (Ramalingam and
+// Reps). an increase only affects the subtree below the edge if the edge is in the tree: that subtree is
+// cut off and reattached from its unaffected neighbours. a decrease only matters if it gives the edge's
+// head a shorter distance. either way the repair is a Dijkstra over the nodes whose distance changes,
+// which for a local traffic update is a small part of the graph.
+class DynamicShortestPathTree {
+public:
+	// empty until build is called
+	explicit DynamicShortestPathTree(const MapGraph& graph);
+
+	DynamicShortestPathTree(const DynamicShortestPathTree&) = delete;
+	DynamicShortestPathTree& operator=(const DynamicShortestPathTree&) = delete;
+
+	// computes the full tree from source, replacing the current one, and returns the route to "to"
+	PathfindingSolution build(Node* source, Node* to, const PathfindingOptions& options = {});
+
+	// updates the tree after MapGraph::updateWeights applied the batch, and returns the route to "to"
+	// on it. checked holds the edges the repair scanned and stats its effort. a tree that missed an
+	// earlier update is rebuilt instead, and without a tree the route is empty. not cancellable: the tree
+	// is only consistent once it returns
+	PathfindingSolution repair(const std::vector<WeightUpdate>& updates, Node* to, const PathfindingOptions& options = {});
+
+	// route to "to" on the current tree; empty if it cannot be reached
+	PathfindingSolution route(Node* to) const;
+
+	Node* source() const { return sourceNode; }
+	double distance(uint32_t node) const { return tree.distance[node]; }
+	const ShortestPathTree& shortestPathTree() const { return tree; }
+private:
+	// label-correcting Dijkstra from the queued nodes; scanned edges go to checked when it is not null,
+	// the first time marks sees them
+	void propagate(std::vector<Edge*>* checked, SearchContext* marks, SearchStats& stats);
+
+	std::vector<Edge*> pathTo(uint32_t node) const;
+
+	const MapGraph& graph;
+	Node* sourceNode = nullptr;
+	ShortestPathTree tree{};
+	uint64_t weightsVersion = 0; // MapGraph::weightsVersion the tree is correct for
+
+	// scratch, kept between repairs
+	pathfinding::BinaryHeap heap{};
+	std::vector<uint32_t> affected{};
+};
@@ -0,0 +1,143 @@
+#include "pathfinding.h"
+
+#include "SearchContext.h"
+#include "SearchHelpers.h"
+
+// std
+#include <algorithm>
+
+namespace {
+    using pathfinding::currentTimestamp;
+    using pathfinding::currentNanoseconds;
+    using pathfinding::ZeroPotential;
+
+    // turn costs are never negative, so the straight-line distance stays consistent
+    using pathfinding::EuclideanPotential;
+
+    // label-setting search over edges, each standing for the moment its head node is reached. the outgoing
+    // edges of "from" start the search at their own weights; the turn from edge e onto edge f costs the
+    // turn cost of its type plus the weight of f, read from row e of the head node's turn table.
+    // returns the edge the search reached "to" by, or UINT32_MAX if it did not
+    template <typename Queue, typename Potential>
+    uint32_t edgeBasedSearch(MapGraph& graph, uint32_t from, uint32_t target, bool stopAtTarget, SearchContext& context, const Potential& potential,
+        const double (&turnCosts)[4], std::vector<Edge*>* checked, const SearchControl* control, SearchStats& stats) {
+        // CSR views
+        const uint32_t* offsets = graph.offsets.data();
+        const uint32_t* targets = graph.targets.data();
+        const double* weights = graph.weights.data();
+        const uint32_t* reverseOffsets = graph.reverseOffsets.data();
+        const uint32_t* reverseSlots = graph.reverseSlots.data();
+        const uint32_t* turnTableOffsets = graph.turnTableOffsets.data();
+        const uint8_t* turnTables = graph.turnTables.data();
+
+        Queue& todo = context.queue<Queue>();
+        for (uint32_t slot = offsets[from]; slot < offsets[from + 1]; slot++) {
+            context.update(slot, weights[slot], UINT32_MAX);
+            todo.push(slot, weights[slot] + potential(targets[slot]));
+            if (checked && context.markEdge(slot))
+                checked->push_back(graph.edges[slot]);
+        }
+
+        uint32_t arrival = UINT32_MAX;
+        while (!todo.empty()) {
+            const pathfinding::QueueEntry top = todo.pop();
+            const uint32_t e = top.node;
+            if (context.settled(e)) continue; // stale entry left behind by lazy deletion
+            context.settle(e);
+            stats.settledNodes++;
+            const uint32_t v = targets[e];
+            if (v == target && arrival == UINT32_MAX) {
+                arrival = e;
+                if (stopAtTarget) break;
+            }
+            if (control && stats.settledNodes % SearchControl::CHECKPOINT_INTERVAL == 0 && control->checkpoint(checked)) break;
+
+            const uint32_t outCount = offsets[v + 1] - offsets[v];
+            const uint8_t* turns = turnTables + turnTableOffsets[v] + static_cast<size_t>(reverseSlots[e] - reverseOffsets[v]) * outCount;
+            stats.relaxedEdges += outCount;
+            const double distE = context.distance(e);
+            for (uint32_t j = 0; j < outCount; j++) {
+                if (turns[j] == static_cast<uint8_t>(TurnType::Forbidden)) continue;
+                const uint32_t f = offsets[v] + j;
+                const double newDist = distE + turnCosts[turns[j]] + weights[f];
+
+                // edge relaxation
+                if (newDist < context.distance(f)) {
+                    context.update(f, newDist, e);
+                    // keys never drop below the current minimum; guards monotone queues against rounding
+                    todo.push(f, std::max(newDist + potential(targets[f]), top.key));
+                }
+
+                // record all checked edges
+                if (checked && context.markEdge(f))
+                    checked->push_back(graph.edges[f]);
+            }
+        }
+        return arrival;
+    }
+
+    template <typename Potential>
+    PathfindingSolution runEdgeBasedSearch(MapGraph& graph, Node* from, Node* to, const TurnCosts& costs, const PathfindingOptions& options,
+        const Potential& potential) {
+        const auto beginTimestamp = currentTimestamp();
+
+        // labels per edge; reused between queries on this thread
+        SearchContext::Handle context = SearchContext::acquire(graph.edgeCount(), options.recordChecked ? graph.edgeCount() : 0);
+
+        // record all checked edges
+        std::vector<Edge*> checked{};
+
+        // indexed by TurnType
+        const double turnCosts[4] = { costs.straight, costs.right, costs.left, costs.uTurn };
+
+        SearchStats stats{};
+        const long long beginNanoseconds = currentNanoseconds();
+        const uint32_t source = static_cast<uint32_t>(from->id);
+        const uint32_t target = static_cast<uint32_t>(to->id);
+        uint32_t arrival = UINT32_MAX;
+        if (source != target) {
+            std::vector<Edge*>* recorded = options.recordChecked ? &checked : nullptr;
+            switch (options.queue) {
+            case pathfinding::QueueType::QuaternaryHeap:
+                arrival = edgeBasedSearch<pathfinding::QuaternaryHeap>(graph, source, target, options.stopAtTarget, *context, potential, turnCosts, recorded,
+                    options.control, stats);
+                break;
+            case pathfinding::QueueType::RadixHeap:
+                arrival = edgeBasedSearch<pathfinding::RadixHeap>(graph, source, target, options.stopAtTarget, *context, potential, turnCosts, recorded,
+                    options.control, stats);
+                break;
+            default:
+                arrival = edgeBasedSearch<pathfinding::BinaryHeap>(graph, source, target, options.stopAtTarget, *context, potential, turnCosts, recorded,
+                    options.control, stats);
+                break;
+            }
+        }
+        stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+        const auto endTimestamp = currentTimestamp();
+
+        if (options.control && options.control->isCancelled()) return { checked, {}, beginTimestamp, endTimestamp, stats, true };
+
+        if (arrival == UINT32_MAX) return { checked, {}, beginTimestamp, endTimestamp, stats };
+
+        // construct optimal path; the predecessor of an edge is the edge before it
+        std::vector<Edge*> path;
+        for (uint32_t e = arrival; e != UINT32_MAX; e = context->predecessor(e))
+            path.push_back(graph.edges[e]);
+
+        std::reverse(path.begin(), path.end());
+
+        return { checked, path, beginTimestamp, endTimestamp, stats };
+    }
+}
+
+PathfindingSolution pathfinding::edgeBasedDijkstra(MapGraph& graph, Node* from, Node* to, const TurnCosts& costs, const PathfindingOptions& options) {
+    return runEdgeBasedSearch(graph, from, to, costs, options, ZeroPotential{});
+}
+
+PathfindingSolution pathfinding::edgeBasedAstar(MapGraph& graph, Node* from, Node* to, const TurnCosts& costs, const PathfindingOptions& options) {
+    // the potential only pays off when the search stops at the target
+    PathfindingOptions targeted = options;
+    targeted.stopAtTarget = true;
+    return runEdgeBasedSearch(graph, from, to, costs, targeted, EuclideanPotential{ graph, static_cast<uint32_t>(to->id) });
+}
@@ -0,0 +1,202 @@
+#include "GraphPartition.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    // share of a range, at each end of the projection, that becomes source or sink of the flow
+    constexpr double INERTIAL_FLOW_TERMINALS = 0.4;
+
+    // directions the nodes are projected onto; the smallest cut among them is kept
+    constexpr double DIRECTIONS[4][2] = { { 1.0, 0.0 }, { 0.0, 1.0 }, { 0.70710678, 0.70710678 }, { 0.70710678, -0.70710678 } };
+
+    // median split along the longer side of the bounding box; returns where the second half starts
+    uint32_t* coordinateCut(const MapGraph& graph, uint32_t* begin, uint32_t* end) {
+        double minX = DBL_MAX, maxX = -DBL_MAX, minY = DBL_MAX, maxY = -DBL_MAX;
+        for (const uint32_t* node = begin; node != end; ++node) {
+            minX = std::min(minX, graph.xs[*node]);
+            maxX = std::max(maxX, graph.xs[*node]);
+            minY = std::min(minY, graph.ys[*node]);
+            maxY = std::max(maxY, graph.ys[*node]);
+        }
+
+        const GraphArray<double>& axis = maxX - minX >= maxY - minY ? graph.xs : graph.ys;
+        uint32_t* middle = begin + (end - begin) / 2;
+        std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) { return axis[a] < axis[b]; });
+        return middle;
+    }
+
+    // inertial flow (Schild and Sommer): for every direction, the first nodes along it are tied to a source
+    // and the last ones to a sink, and a minimum edge cut between them is found by max flow over the edges
+    // inside the range, taken as undirected with unit capacity. the side reachable from the sources in the
+    // residual graph goes first. "local" is UINT32_MAX for every node and is left that way
+    uint32_t* inertialFlowCut(const MapGraph& graph, uint32_t* begin, uint32_t* end, std::vector<uint32_t>& local) {
+        const uint32_t size = static_cast<uint32_t>(end - begin);
+        for (uint32_t i = 0; i < size; i++)
+            local[begin[i]] = i;
+
+        // an edge is the arc pair 2k, 2k + 1; the tail of arc a is the head of a ^ 1
+        std::vector<uint32_t> heads{};
+        for (uint32_t i = 0; i < size; i++) {
+            for (uint32_t slot = graph.offsets[begin[i]]; slot < graph.offsets[begin[i] + 1]; slot++) {
+                const uint32_t j = local[graph.targets[slot]];
+                if (j == UINT32_MAX) continue;
+                heads.push_back(j);
+                heads.push_back(i);
+            }
+        }
+        std::vector<uint32_t> arcOffsets(size + 1, 0);
+        for (size_t a = 0; a < heads.size(); a++)
+            arcOffsets[heads[a ^ 1] + 1]++;
+        for (uint32_t i = 0; i < size; i++)
+            arcOffsets[i + 1] += arcOffsets[i];
+        std::vector<uint32_t> cursor(arcOffsets.begin(), arcOffsets.end() - 1);
+        std::vector<uint32_t> arcs(heads.size());
+        for (uint32_t a = 0; a < heads.size(); a++)
+            arcs[cursor[heads[a ^ 1]]++] = a;
+
+        const uint32_t terminals = std::max<uint32_t>(1, static_cast<uint32_t>(size * INERTIAL_FLOW_TERMINALS));
+        enum Role : uint8_t { Inner, Source, Sink };
+        std::vector<uint32_t> projected(size);
+        std::vector<uint8_t> role(size);
+        std::vector<int8_t> flow(heads.size());
+        std::vector<uint32_t> level(size);
+        std::vector<uint32_t> queue{};
+        std::vector<uint32_t> path{};
+
+        size_t bestCut = SIZE_MAX;
+        uint32_t bestImbalance = UINT32_MAX;
+        std::vector<uint8_t> bestSide(size, 0);
+        for (const auto& direction : DIRECTIONS) {
+            std::iota(projected.begin(), projected.end(), 0);
+            std::sort(projected.begin(), projected.end(), [&](uint32_t a, uint32_t b) {
+                return graph.xs[begin[a]] * direction[0] + graph.ys[begin[a]] * direction[1]
+                    < graph.xs[begin[b]] * direction[0] + graph.ys[begin[b]] * direction[1];
+            });
+            std::fill(role.begin(), role.end(), Inner);
+            for (uint32_t k = 0; k < terminals; k++) {
+                role[projected[k]] = Source;
+                role[projected[size - 1 - k]] = Sink;
+            }
+            std::fill(flow.begin(), flow.end(), 0);
+
+            // Dinic: a breadth-first search layers the residual graph, then depth-first searches push unit
+            // paths along the layers until every source is blocked
+            size_t cut = 0;
+            while (true) {
+                std::fill(level.begin(), level.end(), UINT32_MAX);
+                queue.clear();
+                for (uint32_t k = 0; k < terminals; k++) {
+                    level[projected[k]] = 0;
+                    queue.push_back(projected[k]);
+                }
+                bool reached = false;
+                for (size_t q = 0; q < queue.size(); q++) {
+                    const uint32_t v = queue[q];
+                    if (role[v] == Sink) {
+                        reached = true;
+                        continue;
+                    }
+                    for (uint32_t k = arcOffsets[v]; k < arcOffsets[v + 1]; k++) {
+                        const uint32_t a = arcs[k];
+                        if (flow[a] < 1 && level[heads[a]] == UINT32_MAX) {
+                            level[heads[a]] = level[v] + 1;
+                            queue.push_back(heads[a]);
+                        }
+                    }
+                }
+                if (!reached || cut > bestCut) break; // a worse cut than the best one so far is not finished
+
+                cursor.assign(arcOffsets.begin(), arcOffsets.end() - 1);
+                for (uint32_t k = 0; k < terminals; k++) {
+                    const uint32_t source = projected[k];
+                    path.clear();
+                    uint32_t v = source;
+                    while (true) {
+                        if (role[v] == Sink) {
+                            for (uint32_t a : path) {
+                                flow[a]++;
+                                flow[a ^ 1]--;
+                            }
+                            cut++;
+                            path.clear();
+                            v = source;
+                            continue;
+                        }
+                        while (cursor[v] < arcOffsets[v + 1]) {
+                            const uint32_t a = arcs[cursor[v]];
+                            if (flow[a] < 1 && level[heads[a]] == level[v] + 1) break;
+                            cursor[v]++;
+                        }
+                        if (cursor[v] < arcOffsets[v + 1]) {
+                            path.push_back(arcs[cursor[v]]);
+                            v = heads[path.back()];
+                            continue;
+                        }
+
+                        // dead end: nothing more goes through v in this phase
+                        level[v] = UINT32_MAX;
+                        if (path.empty()) break;
+                        v = heads[path.back() ^ 1];
+                        path.pop_back();
+                        cursor[v]++;
+                    }
+                }
+            }
+            if (cut > bestCut) continue;
+
+            // the last search did not reach a sink, so its levels mark the source side
+            uint32_t sourceSide = 0;
+            for (uint32_t i = 0; i < size; i++)
+                sourceSide += level[i] != UINT32_MAX;
+            const uint32_t imbalance = static_cast<uint32_t>(std::abs(static_cast<int64_t>(sourceSide) * 2 - size));
+            if (cut < bestCut || imbalance < bestImbalance) {
+                bestCut = cut;
+                bestImbalance = imbalance;
+                for (uint32_t i = 0; i < size; i++)
+                    bestSide[i] = level[i] != UINT32_MAX;
+            }
+        }
+
+        uint32_t* middle = std::stable_partition(begin, end, [&](uint32_t node) { return bestSide[local[node]] != 0; });
+        for (uint32_t* node = begin; node != end; ++node)
+            local[*node] = UINT32_MAX;
+        return middle;
+    }
+}
+
+GraphPartition::GraphPartition(const MapGraph& graph, const std::vector<uint32_t>& maxCellSizes, Bisection bisection) {
+    if (maxCellSizes.empty() || maxCellSizes.front() == 0 || !std::is_sorted(maxCellSizes.begin(), maxCellSizes.end()))
+        throw std::runtime_error("invalid partition cell sizes!");
+
+    cells.assign(maxCellSizes.size(), std::vector<uint32_t>(graph.nodeCount()));
+    cellCounts.assign(maxCellSizes.size(), 0);
+
+    nodeOrder.resize(graph.nodeCount());
+    std::iota(nodeOrder.begin(), nodeOrder.end(), 0);
+    std::vector<uint32_t> local{};
+    if (bisection == Bisection::InertialFlow)
+        local.assign(graph.nodeCount(), UINT32_MAX);
+    bisect(graph, maxCellSizes, local, nodeOrder.data(), nodeOrder.data() + nodeOrder.size(), maxCellSizes.size() - 1);
+}
+
+void GraphPartition::bisect(const MapGraph& graph, const std::vector<uint32_t>& maxCellSizes, std::vector<uint32_t>& local,
+    uint32_t* begin, uint32_t* end, size_t level) {
+    if (static_cast<size_t>(end - begin) > maxCellSizes[level]) {
+        uint32_t* middle = local.empty() ? coordinateCut(graph, begin, end) : inertialFlowCut(graph, begin, end, local);
+        bisect(graph, maxCellSizes, local, begin, middle, level);
+        bisect(graph, maxCellSizes, local, middle, end, level);
+        return;
+    }
+
+    // small enough to be a cell of this level, which the lower levels subdivide further
+    const uint32_t cell = cellCounts[level]++;
+    for (const uint32_t* node = begin; node != end; ++node)
+        cells[level][*node] = cell;
+    if (level > 0)
+        bisect(graph, maxCellSizes, local, begin, end, level - 1);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "MapGraph.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+// how a cell too large for its level is split in two
+enum class Bisection {
+	Coordinate,  // at the median along the longer side of the bounding box; fast, but cuts many edges
+	InertialFlow // at a minimum edge cut between the two ends of the cell along one of a few directions
+};
+
+// nested multilevel partition of the nodes of a MapGraph. level 0 has the smallest cells; every cell of
+// level l + 1 is a union of whole cells of level l. cells are cut by recursive bisection until they fit.
+class GraphPartition {
+public:
+	// maxCellSizes holds the largest allowed cell of every level, increasing from level 0
+	GraphPartition(const MapGraph& graph, const std::vector<uint32_t>& maxCellSizes, Bisection bisection = Bisection::InertialFlow);
+
+	GraphPartition(const GraphPartition&) = delete;
+	GraphPartition& operator=(const GraphPartition&) = delete;
+
+	size_t levelCount() const { return cellCounts.size(); }
+	size_t cellCount(size_t level) const { return cellCounts[level]; }
+	uint32_t cell(size_t level, uint32_t node) const { return cells[level][node]; }
+
+	// every node once, ordered so that the cells of every level are contiguous and numbered in order
+	const std::vector<uint32_t>& order() const { return nodeOrder; }
+private:
+	// "local" is scratch for the inertial flow cut, empty for coordinate bisection
+	void bisect(const MapGraph& graph, const std::vector<uint32_t>& maxCellSizes, std::vector<uint32_t>& local,
+		uint32_t* begin, uint32_t* end, size_t level);
+
+	std::vector<std::vector<uint32_t>> cells{}; // cell of every node, per level
+	std::vector<uint32_t> cellCounts{};
+	std::vector<uint32_t> nodeOrder{};
+};
@@ -0,0 +1,375 @@
+#include "HubLabels.h"
+
+#include "SearchHelpers.h"
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HUB_LABELS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint32_t NO_ARC = ContractionHierarchy::NO_ARC;
+
+    // relative slack of the pruning test, so rounding never prunes an entry that holds the true distance;
+    // paths are unpacked by following those entries from node to node
+    constexpr double PRUNE_SLACK = 1e-12;
+
+    constexpr size_t BUILD_GRAIN = 16; // nodes per task within a level
+
+    using pathfinding::currentTimestamp;
+    using pathfinding::currentNanoseconds;
+
+    struct LabelEntry {
+        uint32_t hub;
+        uint32_t arc;
+        double distance;
+    };
+
+    // smallest distance over the hubs both labels hold; scalar, for the build
+    double meet(const std::vector<LabelEntry>& forward, const std::vector<LabelEntry>& backward) {
+        double best = DBL_MAX;
+        size_t i = 0, j = 0;
+        while (i < forward.size() && j < backward.size()) {
+            if (forward[i].hub < backward[j].hub) {
+                i++;
+            } else if (forward[i].hub > backward[j].hub) {
+                j++;
+            } else {
+                best = std::min(best, forward[i].distance + backward[j].distance);
+                i++;
+                j++;
+            }
+        }
+        return best;
+    }
+
+    // smallest distance over the hubs two sorted labels share, DBL_MAX if there is none; bestA and bestB
+    // receive the positions of the best hub in either label
+    double intersect(const uint32_t* hubsA, const double* distancesA, size_t countA, const uint32_t* hubsB, const double* distancesB, size_t countB,
+        size_t& bestA, size_t& bestB) {
+        double best = DBL_MAX;
+        size_t i = 0, j = 0;
+#ifdef HUB_LABELS_SSE2
+        // four hubs of one label against all rotations of four of the other; shared hubs are rare, so a
+        // match is resolved lane by lane
+        while (i + 4 <= countA && j + 4 <= countB) {
+            const __m128i blockA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hubsA + i));
+            const __m128i blockB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hubsB + j));
+            const __m128i equal = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(blockA, blockB), _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm_or_si128(_mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(1, 0, 3, 2))),
+                    _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(2, 1, 0, 3)))));
+            const int matches = _mm_movemask_ps(_mm_castsi128_ps(equal));
+            for (size_t lane = 0; matches != 0 && lane < 4; lane++) {
+                if (!(matches & (1 << lane))) continue;
+                for (size_t k = 0; k < 4; k++) {
+                    if (hubsB[j + k] != hubsA[i + lane]) continue;
+                    if (distancesA[i + lane] + distancesB[j + k] < best) {
+                        best = distancesA[i + lane] + distancesB[j + k];
+                        bestA = i + lane;
+                        bestB = j + k;
+                    }
+                    break;
+                }
+            }
+
+            // a block whose last hub is not above the other's cannot match anything further on
+            const uint32_t lastA = hubsA[i + 3];
+            const uint32_t lastB = hubsB[j + 3];
+            if (lastA <= lastB) i += 4;
+            if (lastB <= lastA) j += 4;
+        }
+#endif
+        while (i < countA && j < countB) {
+            if (hubsA[i] < hubsB[j]) {
+                i++;
+            } else if (hubsA[i] > hubsB[j]) {
+                j++;
+            } else {
+                if (distancesA[i] + distancesB[j] < best) {
+                    best = distancesA[i] + distancesB[j];
+                    bestA = i;
+                    bestB = j;
+                }
+                i++;
+                j++;
+            }
+        }
+        return best;
+    }
+
+    // the path source -> hub -> target. arcOf(side, node) returns the arc of the entry for the hub in the
+    // node's label: the next arc up towards the hub on side 0, the next arc down from it on side 1
+    template <typename ArcOf>
+    std::vector<Edge*> unpackPath(const ContractionHierarchy& hierarchy, uint32_t source, uint32_t target, uint32_t hub, const ArcOf& arcOf) {
+        std::vector<Edge*> path{};
+        for (uint32_t node = source; node != hub; ) {
+            const uint32_t arc = arcOf(0, node);
+            hierarchy.unpack(arc, path);
+            node = hierarchy.arcs[arc].to;
+        }
+        std::vector<uint32_t> downward{};
+        for (uint32_t node = target; node != hub; ) {
+            downward.push_back(arcOf(1, node));
+            node = hierarchy.arcs[downward.back()].from;
+        }
+        for (auto it = downward.rbegin(); it != downward.rend(); ++it)
+            hierarchy.unpack(*it, path);
+        return path;
+    }
+
+    void writeVarint(std::vector<uint8_t>& bytes, uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint64_t readVarint(const uint8_t*& cursor) {
+        uint64_t value = 0;
+        for (int shift = 0; ; shift += 7) {
+            const uint8_t byte = *cursor++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+}
+
+HubLabels::HubLabels(const ContractionHierarchy& hierarchy, ThreadPool& pool) : hierarchy{ hierarchy } {
+    const size_t nodeCount = hierarchy.rank.size();
+    std::vector<uint32_t> hubOf(nodeCount);
+    hubNodes.resize(nodeCount);
+    for (uint32_t v = 0; v < nodeCount; v++) {
+        hubOf[v] = static_cast<uint32_t>(nodeCount - 1 - hierarchy.rank[v]);
+        hubNodes[hubOf[v]] = v;
+    }
+
+    // a node's labels need those of all its higher neighbours, so a node's level is one more than theirs
+    // and the nodes of one level are independent
+    std::vector<uint32_t> level(nodeCount, 0);
+    uint32_t levelCount = 0;
+    for (uint32_t v : hubNodes) {
+        for (uint32_t i = hierarchy.upOffsets[v]; i < hierarchy.upOffsets[v + 1]; i++)
+            level[v] = std::max(level[v], level[hierarchy.arcs[hierarchy.upArcs[i]].to] + 1);
+        for (uint32_t i = hierarchy.downOffsets[v]; i < hierarchy.downOffsets[v + 1]; i++)
+            level[v] = std::max(level[v], level[hierarchy.arcs[hierarchy.downArcs[i]].from] + 1);
+        levelCount = std::max(levelCount, level[v] + 1);
+    }
+    std::vector<uint32_t> levelOffsets(levelCount + 1, 0);
+    for (uint32_t v = 0; v < nodeCount; v++)
+        levelOffsets[level[v] + 1]++;
+    for (uint32_t l = 0; l < levelCount; l++)
+        levelOffsets[l + 1] += levelOffsets[l];
+    std::vector<uint32_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    std::vector<uint32_t> byLevel(nodeCount);
+    for (uint32_t v = 0; v < nodeCount; v++)
+        byLevel[cursor[level[v]]++] = v;
+
+    std::vector<std::vector<LabelEntry>> labels[2]{ std::vector<std::vector<LabelEntry>>(nodeCount), std::vector<std::vector<LabelEntry>>(nodeCount) };
+    const auto buildLabel = [&](int side, uint32_t v) {
+        const std::vector<uint32_t>& arcOffsets = side == 0 ? hierarchy.upOffsets : hierarchy.downOffsets;
+        const std::vector<uint32_t>& arcIds = side == 0 ? hierarchy.upArcs : hierarchy.downArcs;
+        std::vector<LabelEntry>& label = labels[side][v];
+
+        // the hub itself, and every entry of a higher neighbour extended by the arc to it
+        label.push_back({ hubOf[v], NO_ARC, 0.0 });
+        for (uint32_t i = arcOffsets[v]; i < arcOffsets[v + 1]; i++) {
+            const ContractionHierarchy::Arc& arc = hierarchy.arcs[arcIds[i]];
+            for (const LabelEntry& entry : labels[side][side == 0 ? arc.to : arc.from])
+                label.push_back({ entry.hub, arcIds[i], entry.distance + arc.weight });
+        }
+        std::sort(label.begin(), label.end(), [](const LabelEntry& a, const LabelEntry& b) {
+            return a.hub < b.hub || (a.hub == b.hub && a.distance < b.distance);
+        });
+        label.erase(std::unique(label.begin(), label.end(), [](const LabelEntry& a, const LabelEntry& b) { return a.hub == b.hub; }), label.end());
+
+        // an entry is redundant when the labels already meet on a shorter path through another hub
+        std::vector<LabelEntry> kept{};
+        kept.reserve(label.size());
+        for (const LabelEntry& entry : label) {
+            const std::vector<LabelEntry>& other = labels[1 - side][hubNodes[entry.hub]];
+            const double covered = side == 0 ? meet(label, other) : meet(other, label);
+            if (entry.arc == NO_ARC || covered >= entry.distance * (1.0 - PRUNE_SLACK))
+                kept.push_back(entry);
+        }
+        label = std::move(kept);
+        label.shrink_to_fit();
+    };
+
+    for (uint32_t l = 0; l < levelCount; l++) {
+        pool.parallelFor(levelOffsets[l], levelOffsets[l + 1], BUILD_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                buildLabel(0, byLevel[i]);
+                buildLabel(1, byLevel[i]);
+            }
+        });
+    }
+
+    for (int side = 0; side < 2; side++) {
+        offsets[side].assign(nodeCount + 1, 0);
+        for (uint32_t v = 0; v < nodeCount; v++) {
+            offsets[side][v] = static_cast<uint32_t>(hubs.size());
+            for (const LabelEntry& entry : labels[side][v]) {
+                hubs.push_back(entry.hub);
+                distances.push_back(entry.distance);
+                arcs.push_back(entry.arc);
+            }
+            std::vector<LabelEntry>{}.swap(labels[side][v]);
+        }
+        offsets[side][nodeCount] = static_cast<uint32_t>(hubs.size());
+    }
+}
+
+double HubLabels::distance(uint32_t from, uint32_t to) const {
+    size_t bestA = 0, bestB = 0;
+    return intersect(&hubs[offsets[0][from]], &distances[offsets[0][from]], offsets[0][from + 1] - offsets[0][from],
+        &hubs[offsets[1][to]], &distances[offsets[1][to]], offsets[1][to + 1] - offsets[1][to], bestA, bestB);
+}
+
+PathfindingSolution HubLabels::query(Node* from, Node* to, const PathfindingOptions& /*options*/) const {
+    const auto beginTimestamp = currentTimestamp();
+    const long long beginNanoseconds = currentNanoseconds();
+    const uint32_t source = static_cast<uint32_t>(from->id);
+    const uint32_t target = static_cast<uint32_t>(to->id);
+
+    SearchStats stats{};
+    const uint32_t forwardBegin = offsets[0][source];
+    const uint32_t backwardBegin = offsets[1][target];
+    size_t bestA = 0, bestB = 0;
+    const double best = intersect(&hubs[forwardBegin], &distances[forwardBegin], offsets[0][source + 1] - forwardBegin,
+        &hubs[backwardBegin], &distances[backwardBegin], offsets[1][target + 1] - backwardBegin, bestA, bestB);
+    stats.relaxedEdges = (offsets[0][source + 1] - forwardBegin) + (offsets[1][target + 1] - backwardBegin);
+    stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+    std::vector<Edge*> path{};
+    if (best != DBL_MAX) {
+        const uint32_t hub = hubs[forwardBegin + bestA];
+        path = unpackPath(hierarchy, source, target, hubNodes[hub], [&](int side, uint32_t node) {
+            const uint32_t* begin = &hubs[offsets[side][node]];
+            const uint32_t* end = &hubs[offsets[side][node + 1]];
+            return arcs[std::lower_bound(begin, end, hub) - hubs.data()];
+        });
+    }
+
+    return { {}, path, beginTimestamp, currentTimestamp(), stats };
+}
+
+size_t HubLabels::memoryBytes() const {
+    return (hubNodes.size() + offsets[0].size() + offsets[1].size() + hubs.size() + arcs.size()) * sizeof(uint32_t)
+        + distances.size() * sizeof(double);
+}
+
+CompressedHubLabels::CompressedHubLabels(const HubLabels& labels, double resolution)
+    : hierarchy{ labels.hierarchy }, hubNodes{ labels.hubNodes }, distanceResolution{ resolution } {
+    const size_t nodeCount = hubNodes.size();
+    for (int side = 0; side < 2; side++) {
+        offsets[side].resize(nodeCount + 1);
+        for (uint32_t v = 0; v < nodeCount; v++) {
+            offsets[side][v] = bytes[side].size();
+            const uint32_t begin = labels.offsets[side][v];
+            const uint32_t end = labels.offsets[side][v + 1];
+            writeVarint(bytes[side], end - begin);
+
+            // per entry: hub id minus the previous one, the distance, then arc + 1 so NO_ARC codes as 0
+            uint32_t previousHub = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                writeVarint(bytes[side], labels.hubs[i] - previousHub);
+                previousHub = labels.hubs[i];
+                if (resolution > 0.0) {
+                    writeVarint(bytes[side], static_cast<uint64_t>(std::llround(labels.distances[i] / resolution)));
+                } else {
+                    uint8_t raw[sizeof(double)];
+                    std::memcpy(raw, &labels.distances[i], sizeof(double));
+                    bytes[side].insert(bytes[side].end(), raw, raw + sizeof(double));
+                }
+                writeVarint(bytes[side], labels.arcs[i] == NO_ARC ? 0 : static_cast<uint64_t>(labels.arcs[i]) + 1);
+            }
+        }
+        offsets[side][nodeCount] = bytes[side].size();
+        bytes[side].shrink_to_fit();
+    }
+}
+
+void CompressedHubLabels::decode(int side, uint32_t node, std::vector<Entry>& label) const {
+    const uint8_t* cursor = bytes[side].data() + offsets[side][node];
+    label.resize(readVarint(cursor));
+    uint32_t hub = 0;
+    for (Entry& entry : label) {
+        hub += static_cast<uint32_t>(readVarint(cursor));
+        entry.hub = hub;
+        if (distanceResolution > 0.0) {
+            entry.distance = readVarint(cursor) * distanceResolution;
+        } else {
+            std::memcpy(&entry.distance, cursor, sizeof(double));
+            cursor += sizeof(double);
+        }
+        entry.arc = static_cast<uint32_t>(readVarint(cursor)) - 1;
+    }
+}
+
+double CompressedHubLabels::meet(uint32_t from, uint32_t to, uint32_t& bestHub, size_t& merged) const {
+    thread_local std::vector<Entry> forward{};
+    thread_local std::vector<Entry> backward{};
+    decode(0, from, forward);
+    decode(1, to, backward);
+    merged = forward.size() + backward.size();
+
+    double best = DBL_MAX;
+    size_t i = 0, j = 0;
+    while (i < forward.size() && j < backward.size()) {
+        if (forward[i].hub < backward[j].hub) {
+            i++;
+        } else if (forward[i].hub > backward[j].hub) {
+            j++;
+        } else {
+            if (forward[i].distance + backward[j].distance < best) {
+                best = forward[i].distance + backward[j].distance;
+                bestHub = forward[i].hub;
+            }
+            i++;
+            j++;
+        }
+    }
+    return best;
+}
+
+double CompressedHubLabels::distance(uint32_t from, uint32_t to) const {
+    uint32_t hub = 0;
+    size_t merged = 0;
+    return meet(from, to, hub, merged);
+}
+
+PathfindingSolution CompressedHubLabels::query(Node* from, Node* to, const PathfindingOptions& /*options*/) const {
+    const auto beginTimestamp = currentTimestamp();
+    const long long beginNanoseconds = currentNanoseconds();
+    const uint32_t source = static_cast<uint32_t>(from->id);
+    const uint32_t target = static_cast<uint32_t>(to->id);
+
+    SearchStats stats{};
+    uint32_t hub = 0;
+    const double best = meet(source, target, hub, stats.relaxedEdges);
+    stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+    std::vector<Edge*> path{};
+    if (best != DBL_MAX) {
+        std::vector<Entry> label{};
+        path = unpackPath(hierarchy, source, target, hubNodes[hub], [&](int side, uint32_t node) {
+            decode(side, node, label);
+            return std::lower_bound(label.begin(), label.end(), hub, [](const Entry& entry, uint32_t id) { return entry.hub < id; })->arc;
+        });
+    }
+
+    return { {}, path, beginTimestamp, currentTimestamp(), stats };
+}
+
+size_t CompressedHubLabels::memoryBytes() const {
+    return hubNodes.size() * sizeof(uint32_t) + (offsets[0].size() + offsets[1].size()) * sizeof(uint64_t) + bytes[0].size() + bytes[1].size();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ContractionHierarchy.h"
+#include "MapGraph.h"
+#include "pathfinding.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// hub labeling built on a contraction hierarchy. every node gets a forward label, the hubs its upward
+// search space reaches with their distances, and a backward label for the reversed downward graph; the
+// distance between two nodes is the smallest sum over the hubs their labels share. labels are built from
+// the most important node down, each from the labels of its upward neighbours, and entries that another
+// hub already covers are pruned. hubs are numbered from the most important node down, so a label is an
+// increasing run of hub ids and a query is one merge of two such runs.
+// the hierarchy must outlive the labels; they go stale with it when the weights change
+class HubLabels {
+public:
+	// builds the levels of the hierarchy one after another, the nodes of a level in parallel
+	HubLabels(const ContractionHierarchy& hierarchy, ThreadPool& pool);
+
+	HubLabels(const HubLabels&) = delete;
+	HubLabels& operator=(const HubLabels&) = delete;
+
+	// DBL_MAX if "to" cannot be reached
+	double distance(uint32_t from, uint32_t to) const;
+
+	// options are ignored, since there is no search to record or cancel: checked stays empty and stats
+	// count the label entries merged as relaxed edges. the path is unpacked through the best hub
+	PathfindingSolution query(Node* from, Node* to, const PathfindingOptions& options = {}) const;
+
+	size_t entryCount() const { return hubs.size(); }
+	size_t memoryBytes() const;
+private:
+	friend class CompressedHubLabels;
+
+	const ContractionHierarchy& hierarchy;
+	std::vector<uint32_t> hubNodes{}; // node of every hub id
+
+	// labels in CSR form; side 0 holds the forward labels, side 1 the backward ones. an entry's arc is the
+	// first arc on its path towards the hub (from it, for backward labels), NO_ARC at the hub itself
+	std::vector<uint32_t> offsets[2]{};
+	std::vector<uint32_t> hubs{};
+	std::vector<double> distances{};
+	std::vector<uint32_t> arcs{};
+};
+
+// HubLabels recoded as delta + varint byte streams, a fraction of the size. resolution trades size for
+// precision: 0 keeps distances exact as 8 raw bytes; otherwise they are varints counting multiples of it,
+// and reported distances may be off by up to resolution, with paths as close to shortest. queries decode
+// both labels before merging them, so they are slower than on the plain labels
+class CompressedHubLabels {
+public:
+	// the plain labels may be dropped afterwards; the hierarchy must stay
+	CompressedHubLabels(const HubLabels& labels, double resolution = 0.0);
+
+	CompressedHubLabels(const CompressedHubLabels&) = delete;
+	CompressedHubLabels& operator=(const CompressedHubLabels&) = delete;
+
+	double distance(uint32_t from, uint32_t to) const;
+	PathfindingSolution query(Node* from, Node* to, const PathfindingOptions& options = {}) const;
+
+	double resolution() const { return distanceResolution; }
+	size_t memoryBytes() const;
+private:
+	struct Entry {
+		uint32_t hub;
+		uint32_t arc;
+		double distance;
+	};
+
+	void decode(int side, uint32_t node, std::vector<Entry>& label) const;
+
+	// smallest distance over the shared hubs, which one it is, and how many entries were merged
+	double meet(uint32_t from, uint32_t to, uint32_t& bestHub, size_t& merged) const;
+
+	const ContractionHierarchy& hierarchy;
+	std::vector<uint32_t> hubNodes{};
+	double distanceResolution;
+	std::vector<uint64_t> offsets[2]{}; // byte offset of every label
+	std::vector<uint8_t> bytes[2]{};
+};
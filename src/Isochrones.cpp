@@ -0,0 +1,464 @@
+#include "Isochrones.h"
+
+#include "SearchContext.h"
+#include "SearchHelpers.h"
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ISOCHRONES_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    using pathfinding::BinaryHeap;
+    using pathfinding::QueueEntry;
+    using pathfinding::currentNanoseconds;
+
+    // share of the graph a bounded Dijkstra may settle before compute hands over to a sweep. a sweep costs
+    // about as much as a Dijkstra settling this share, so the search wasted before it at most doubles the cost
+    constexpr double HANDOVER_SHARE = 0.2;
+
+    // outline cells a point is thickened by, in every direction; closes the gaps between neighbouring roads
+    constexpr int OUTLINE_MARGIN = 1;
+
+    // outline vertices within this share of a cell of the simplified outline are dropped; no more than the
+    // thickening, so the outline still encloses the roads
+    constexpr double OUTLINE_TOLERANCE = 1.0;
+
+    // sweep labels of the calling thread, reset to DBL_MAX; reused between sweeps
+    std::vector<double>& sweepLabels(size_t size) {
+        thread_local std::vector<double> labels{};
+        labels.assign(size, DBL_MAX);
+        return labels;
+    }
+
+    // cells of the outline grid. the grid keeps an empty border, so every boundary of the marked area runs
+    // between a marked and an empty cell inside it; one cell wider than the thickening, since a point on the
+    // edge of the bounding box can round into the cell before it
+    struct OutlineGrid {
+        double originX;
+        double originY;
+        double cellSize;
+        int width;
+        int height;
+        std::vector<uint8_t> cells;
+
+        OutlineGrid(double minX, double minY, double maxX, double maxY, double cellSize) : cellSize{ cellSize } {
+            const int border = OUTLINE_MARGIN + 2;
+            originX = minX - border * cellSize;
+            originY = minY - border * cellSize;
+            width = static_cast<int>((maxX - minX) / cellSize) + 2 * border + 1;
+            height = static_cast<int>((maxY - minY) / cellSize) + 2 * border + 1;
+            cells.assign(static_cast<size_t>(width) * height, 0);
+        }
+
+        bool marked(int x, int y) const { return cells[static_cast<size_t>(y) * width + x] != 0; }
+
+        void mark(double x, double y) {
+            const int cx = static_cast<int>((x - originX) / cellSize);
+            const int cy = static_cast<int>((y - originY) / cellSize);
+            cells[static_cast<size_t>(cy) * width + cx] = 1;
+        }
+
+        // points every half cell along the segment
+        void markSegment(double x0, double y0, double x1, double y1) {
+            const double length = std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+            const int steps = static_cast<int>(std::ceil(2.0 * length / cellSize));
+            for (int i = 0; i <= steps; i++) {
+                const double t = steps > 0 ? static_cast<double>(i) / steps : 0.0;
+                mark(x0 + t * (x1 - x0), y0 + t * (y1 - y0));
+            }
+        }
+
+        // thickens the marked cells by OUTLINE_MARGIN in every direction, rows first, then columns
+        void thicken() {
+            std::vector<uint8_t> rows(cells.size(), 0);
+            for (int y = 0; y < height; y++) {
+                for (int x = OUTLINE_MARGIN; x + OUTLINE_MARGIN < width; x++) {
+                    if (!marked(x, y)) continue;
+                    for (int dx = -OUTLINE_MARGIN; dx <= OUTLINE_MARGIN; dx++)
+                        rows[static_cast<size_t>(y) * width + x + dx] = 1;
+                }
+            }
+            std::fill(cells.begin(), cells.end(), 0);
+            for (int y = OUTLINE_MARGIN; y + OUTLINE_MARGIN < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    if (!rows[static_cast<size_t>(y) * width + x]) continue;
+                    for (int dy = -OUTLINE_MARGIN; dy <= OUTLINE_MARGIN; dy++)
+                        cells[static_cast<size_t>(y + dy) * width + x] = 1;
+                }
+            }
+        }
+    };
+
+    // Douglas-Peucker on the open run [first, last] of a ring; keeps the points it needs
+    void simplify(const std::vector<glm::dvec2>& ring, size_t first, size_t last, double tolerance, std::vector<bool>& keep) {
+        if (last <= first + 1) return;
+        const glm::dvec2 a = ring[first];
+        const glm::dvec2 b = ring[last % ring.size()];
+        const glm::dvec2 direction = b - a;
+        const double length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+
+        double farthest = 0.0;
+        size_t split = first;
+        for (size_t i = first + 1; i < last; i++) {
+            const glm::dvec2 offset = ring[i] - a;
+            const double distance = length > 0.0 ? std::abs(direction.x * offset.y - direction.y * offset.x) / length
+                : std::sqrt(offset.x * offset.x + offset.y * offset.y);
+            if (distance > farthest) {
+                farthest = distance;
+                split = i;
+            }
+        }
+        if (farthest <= tolerance) return;
+        keep[split] = true;
+        simplify(ring, first, split, tolerance, keep);
+        simplify(ring, split, last, tolerance, keep);
+    }
+
+    // the outer outlines of the marked cells. every side between a marked and an empty cell becomes a step
+    // along a grid line with the marked cell on its left, and the steps are chained into closed rings; outer
+    // rings wind counter-clockwise, holes clockwise and are dropped
+    std::vector<std::vector<glm::vec2>> traceOutlines(const OutlineGrid& grid) {
+        // steps leaving every grid corner; bit d for direction d
+        constexpr int DX[4] = { 1, 0, -1, 0 };
+        constexpr int DY[4] = { 0, 1, 0, -1 };
+        const int corners = grid.width + 1;
+        std::vector<uint8_t> steps(static_cast<size_t>(corners) * (grid.height + 1), 0);
+        const auto corner = [&](int x, int y) { return static_cast<size_t>(y) * corners + x; };
+        for (int y = 1; y + 1 < grid.height; y++) {
+            for (int x = 1; x + 1 < grid.width; x++) {
+                if (!grid.marked(x, y)) continue;
+                if (!grid.marked(x, y - 1)) steps[corner(x, y)] |= 1 << 0;
+                if (!grid.marked(x + 1, y)) steps[corner(x + 1, y)] |= 1 << 1;
+                if (!grid.marked(x, y + 1)) steps[corner(x + 1, y + 1)] |= 1 << 2;
+                if (!grid.marked(x - 1, y)) steps[corner(x, y + 1)] |= 1 << 3;
+            }
+        }
+
+        std::vector<std::vector<glm::vec2>> outlines{};
+        std::vector<glm::dvec2> ring{};
+        for (size_t start = 0; start < steps.size(); start++) {
+            while (steps[start] != 0) {
+                // follow the steps until the ring closes, turning left where two cells only touch at a corner
+                ring.clear();
+                int x = static_cast<int>(start % corners);
+                int y = static_cast<int>(start / corners);
+                int direction = 0;
+                while (!(steps[start] & (1 << direction))) direction++;
+                double area = 0.0;
+                do {
+                    steps[corner(x, y)] &= ~(1 << direction);
+                    const int nextX = x + DX[direction];
+                    const int nextY = y + DY[direction];
+                    area += static_cast<double>(x) * nextY - static_cast<double>(nextX) * y;
+                    x = nextX;
+                    y = nextY;
+
+                    const int previous = direction;
+                    const uint8_t leaving = steps[corner(x, y)];
+                    if (leaving & (1 << ((previous + 1) & 3))) direction = (previous + 1) & 3;
+                    else if (!(leaving & (1 << previous))) direction = (previous + 3) & 3;
+                    if (direction != previous || corner(x, y) == start)
+                        ring.push_back({ grid.originX + x * grid.cellSize, grid.originY + y * grid.cellSize });
+                } while (corner(x, y) != start);
+
+                if (area <= 0.0 || ring.size() < 3) continue;
+
+                // the staircase of cell sides, straightened to within a fraction of a cell
+                std::vector<bool> keep(ring.size(), false);
+                keep[0] = true;
+                simplify(ring, 0, ring.size(), OUTLINE_TOLERANCE * grid.cellSize, keep);
+                std::vector<glm::vec2> outline{};
+                for (size_t i = 0; i < ring.size(); i++) {
+                    if (keep[i])
+                        outline.push_back(glm::vec2(ring[i]));
+                }
+                if (outline.size() >= 3)
+                    outlines.push_back(std::move(outline));
+            }
+        }
+        return outlines;
+    }
+}
+
+Isochrones::Isochrones(MapGraph& graph, const ContractionHierarchy& hierarchy, double cellSize)
+    : graph{ graph }, hierarchy{ hierarchy }, outlineCellSize{ cellSize } {
+    const size_t nodeCount = graph.nodeCount();
+    order.resize(nodeCount);
+    position.resize(nodeCount);
+    for (uint32_t v = 0; v < nodeCount; v++) {
+        position[v] = static_cast<uint32_t>(nodeCount - 1 - hierarchy.rank[v]);
+        order[position[v]] = v;
+    }
+
+    // every downward arc ends at a less important node, so its tail comes earlier in the sweep
+    sweepOffsets.assign(nodeCount + 1, 0);
+    for (uint32_t p = 0; p < nodeCount; p++) {
+        const uint32_t v = order[p];
+        sweepOffsets[p] = static_cast<uint32_t>(sweepTails.size());
+        for (uint32_t i = hierarchy.downOffsets[v]; i < hierarchy.downOffsets[v + 1]; i++) {
+            const ContractionHierarchy::Arc& arc = hierarchy.arcs[hierarchy.downArcs[i]];
+            sweepTails.push_back(position[arc.from]);
+            sweepWeights.push_back(arc.weight);
+        }
+    }
+    sweepOffsets[nodeCount] = static_cast<uint32_t>(sweepTails.size());
+
+    if (outlineCellSize <= 0.0) {
+        double total = 0.0;
+        for (uint32_t slot = 0; slot < graph.edgeCount(); slot++) {
+            const double dx = graph.xs[graph.targets[slot]] - graph.xs[graph.sources[slot]];
+            const double dy = graph.ys[graph.targets[slot]] - graph.ys[graph.sources[slot]];
+            total += std::sqrt(dx * dx + dy * dy);
+        }
+        outlineCellSize = total > 0.0 ? 0.5 * total / graph.edgeCount() : 1.0;
+    }
+}
+
+Isochrone Isochrones::compute(const std::vector<uint32_t>& sources, double limit) const {
+    Isochrone isochrone{};
+    const size_t budget = static_cast<size_t>(HANDOVER_SHARE * graph.nodeCount());
+    if (!settle(sources, limit, budget, isochrone)) {
+        const SearchStats spent = isochrone.stats;
+        isochrone = {};
+        sweepDistances(sources, limit, isochrone);
+        isochrone.stats.settledNodes += spent.settledNodes;
+        isochrone.stats.relaxedEdges += spent.relaxedEdges;
+        isochrone.stats.nanoseconds += spent.nanoseconds;
+    }
+    finish(isochrone);
+    return isochrone;
+}
+
+Isochrone Isochrones::boundedDijkstra(const std::vector<uint32_t>& sources, double limit) const {
+    Isochrone isochrone{};
+    settle(sources, limit, SIZE_MAX, isochrone);
+    finish(isochrone);
+    return isochrone;
+}
+
+Isochrone Isochrones::sweep(const std::vector<uint32_t>& sources, double limit) const {
+    Isochrone isochrone{};
+    sweepDistances(sources, limit, isochrone);
+    finish(isochrone);
+    return isochrone;
+}
+
+std::vector<Isochrone> Isochrones::computeEach(const std::vector<uint32_t>& sources, double limit, ThreadPool& pool) const {
+#ifdef ISOCHRONES_SSE2
+    static_assert(LANES == 8, "the SIMD sweep relaxes eight lanes");
+#endif
+    const size_t nodeCount = graph.nodeCount();
+    std::vector<Isochrone> isochrones(sources.size());
+    const size_t batches = (sources.size() + LANES - 1) / LANES;
+    pool.parallelFor(0, batches, 1, [&](size_t begin, size_t end) {
+        for (size_t batch = begin; batch < end; batch++) {
+            const size_t first = batch * LANES;
+            const size_t count = std::min(LANES, sources.size() - first);
+
+            SearchStats stats{};
+            const long long beginNanoseconds = currentNanoseconds();
+            std::vector<double>& labels = sweepLabels(nodeCount * LANES);
+            for (size_t lane = 0; lane < count; lane++)
+                upward({ sources[first + lane] }, limit, labels.data(), LANES, lane, stats);
+
+            const uint32_t* offsets = sweepOffsets.data();
+            const uint32_t* tails = sweepTails.data();
+            const double* weights = sweepWeights.data();
+            double* label = labels.data();
+            for (uint32_t p = 0; p < nodeCount; p++, label += LANES) {
+#ifdef ISOCHRONES_SSE2
+                __m128d best0 = _mm_loadu_pd(label);
+                __m128d best1 = _mm_loadu_pd(label + 2);
+                __m128d best2 = _mm_loadu_pd(label + 4);
+                __m128d best3 = _mm_loadu_pd(label + 6);
+                for (uint32_t a = offsets[p]; a < offsets[p + 1]; a++) {
+                    const double* tail = labels.data() + static_cast<size_t>(tails[a]) * LANES;
+                    const __m128d weight = _mm_set1_pd(weights[a]);
+                    best0 = _mm_min_pd(best0, _mm_add_pd(_mm_loadu_pd(tail), weight));
+                    best1 = _mm_min_pd(best1, _mm_add_pd(_mm_loadu_pd(tail + 2), weight));
+                    best2 = _mm_min_pd(best2, _mm_add_pd(_mm_loadu_pd(tail + 4), weight));
+                    best3 = _mm_min_pd(best3, _mm_add_pd(_mm_loadu_pd(tail + 6), weight));
+                }
+                _mm_storeu_pd(label, best0);
+                _mm_storeu_pd(label + 2, best1);
+                _mm_storeu_pd(label + 4, best2);
+                _mm_storeu_pd(label + 6, best3);
+#else
+                for (uint32_t a = offsets[p]; a < offsets[p + 1]; a++) {
+                    const double* tail = labels.data() + static_cast<size_t>(tails[a]) * LANES;
+                    for (size_t lane = 0; lane < LANES; lane++)
+                        label[lane] = std::min(label[lane], tail[lane] + weights[a]);
+                }
+#endif
+            }
+            stats.settledNodes += nodeCount;
+            stats.relaxedEdges += sweepTails.size();
+
+            for (size_t lane = 0; lane < count; lane++) {
+                Isochrone& isochrone = isochrones[first + lane];
+                isochrone.limit = limit;
+                for (uint32_t p = 0; p < nodeCount; p++) {
+                    const double distance = labels[static_cast<size_t>(p) * LANES + lane];
+                    if (distance > limit) continue;
+                    isochrone.nodes.push_back(order[p]);
+                    isochrone.distances.push_back(distance);
+                }
+            }
+
+            // every isochrone of the batch gets an equal share of its effort
+            stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+            for (size_t lane = 0; lane < count; lane++) {
+                Isochrone& isochrone = isochrones[first + lane];
+                isochrone.stats = { stats.settledNodes / count, stats.relaxedEdges / count, stats.nanoseconds / static_cast<long long>(count) };
+                finish(isochrone);
+            }
+        }
+    });
+    return isochrones;
+}
+
+bool Isochrones::settle(const std::vector<uint32_t>& sources, double limit, size_t budget, Isochrone& isochrone) const {
+    const uint32_t* offsets = graph.offsets.data();
+    const uint32_t* targets = graph.targets.data();
+    const double* weights = graph.weights.data();
+
+    isochrone.limit = limit;
+    const long long beginNanoseconds = currentNanoseconds();
+    const SearchContext::Handle context = SearchContext::acquire(graph.nodeCount());
+    BinaryHeap& queue = context->queue<BinaryHeap>();
+    for (uint32_t source : sources) {
+        if (context->distance(source) == 0.0) continue;
+        context->update(source, 0.0, UINT32_MAX);
+        queue.push(source, 0.0);
+    }
+
+    bool complete = true;
+    while (!queue.empty()) {
+        const QueueEntry top = queue.pop();
+        const uint32_t u = top.node;
+        if (context->settled(u)) continue; // stale entry left behind by lazy deletion
+        if (top.key > limit) break;
+        if (isochrone.nodes.size() >= budget) {
+            complete = false;
+            break;
+        }
+        context->settle(u);
+        isochrone.stats.settledNodes++;
+        isochrone.nodes.push_back(u);
+        isochrone.distances.push_back(top.key);
+
+        isochrone.stats.relaxedEdges += offsets[u + 1] - offsets[u];
+        for (uint32_t slot = offsets[u]; slot < offsets[u + 1]; slot++) {
+            const double newDist = top.key + weights[slot];
+            if (newDist <= limit && newDist < context->distance(targets[slot])) {
+                context->update(targets[slot], newDist, slot);
+                queue.push(targets[slot], newDist);
+            }
+        }
+    }
+    isochrone.stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+    return complete;
+}
+
+void Isochrones::sweepDistances(const std::vector<uint32_t>& sources, double limit, Isochrone& isochrone) const {
+    const size_t nodeCount = graph.nodeCount();
+    isochrone.limit = limit;
+    const long long beginNanoseconds = currentNanoseconds();
+    std::vector<double>& labels = sweepLabels(nodeCount);
+    upward(sources, limit, labels.data(), 1, 0, isochrone.stats);
+
+    const uint32_t* offsets = sweepOffsets.data();
+    const uint32_t* tails = sweepTails.data();
+    const double* weights = sweepWeights.data();
+    double* label = labels.data();
+    for (uint32_t p = 0; p < nodeCount; p++) {
+        double best = label[p];
+        for (uint32_t a = offsets[p]; a < offsets[p + 1]; a++)
+            best = std::min(best, label[tails[a]] + weights[a]);
+        label[p] = best;
+        if (best > limit) continue;
+        isochrone.nodes.push_back(order[p]);
+        isochrone.distances.push_back(best);
+    }
+    isochrone.stats.settledNodes += nodeCount;
+    isochrone.stats.relaxedEdges += sweepTails.size();
+    isochrone.stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+}
+
+void Isochrones::upward(const std::vector<uint32_t>& sources, double limit, double* labels, size_t lanes, size_t lane, SearchStats& stats) const {
+    const SearchContext::Handle context = SearchContext::acquire(graph.nodeCount());
+    BinaryHeap& queue = context->queue<BinaryHeap>();
+    for (uint32_t source : sources) {
+        context->update(source, 0.0, ContractionHierarchy::NO_ARC);
+        queue.push(source, 0.0);
+    }
+
+    while (!queue.empty()) {
+        const QueueEntry top = queue.pop();
+        const uint32_t v = top.node;
+        if (context->settled(v)) continue;
+        // a path through a node beyond the limit ends beyond it too
+        if (top.key > limit) break;
+        context->settle(v);
+        stats.settledNodes++;
+        labels[static_cast<size_t>(position[v]) * lanes + lane] = top.key;
+
+        stats.relaxedEdges += hierarchy.upOffsets[v + 1] - hierarchy.upOffsets[v];
+        for (uint32_t i = hierarchy.upOffsets[v]; i < hierarchy.upOffsets[v + 1]; i++) {
+            const ContractionHierarchy::Arc& arc = hierarchy.arcs[hierarchy.upArcs[i]];
+            const double newDist = top.key + arc.weight;
+            if (newDist < context->distance(arc.to)) {
+                context->update(arc.to, newDist, hierarchy.upArcs[i]);
+                queue.push(arc.to, newDist);
+            }
+        }
+    }
+}
+
+void Isochrones::finish(Isochrone& isochrone) const {
+    const uint32_t* offsets = graph.offsets.data();
+    const uint32_t* targets = graph.targets.data();
+    const double* weights = graph.weights.data();
+    const double* xs = graph.xs.data();
+    const double* ys = graph.ys.data();
+    if (isochrone.nodes.empty()) return;
+
+    // the road covered from every reached node: whole edges where the limit allows, else up to where it runs out
+    struct Segment {
+        double x0, y0, x1, y1;
+    };
+    std::vector<Segment> segments{};
+    for (size_t i = 0; i < isochrone.nodes.size(); i++) {
+        const uint32_t u = isochrone.nodes[i];
+        const double remaining = isochrone.limit - isochrone.distances[i];
+        segments.push_back({ xs[u], ys[u], xs[u], ys[u] });
+
+        for (uint32_t slot = offsets[u]; slot < offsets[u + 1]; slot++) {
+            const uint32_t v = targets[slot];
+            const double share = weights[slot] > remaining ? remaining / weights[slot] : 1.0;
+            if (share == 1.0)
+                isochrone.edges.push_back(graph.edges[slot]);
+            segments.push_back({ xs[u], ys[u], xs[u] + share * (xs[v] - xs[u]), ys[u] + share * (ys[v] - ys[u]) });
+        }
+    }
+
+    double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+    for (const Segment& segment : segments) {
+        minX = std::min({ minX, segment.x0, segment.x1 });
+        minY = std::min({ minY, segment.y0, segment.y1 });
+        maxX = std::max({ maxX, segment.x0, segment.x1 });
+        maxY = std::max({ maxY, segment.y0, segment.y1 });
+    }
+    OutlineGrid grid{ minX, minY, maxX, maxY, outlineCellSize };
+    for (const Segment& segment : segments)
+        grid.markSegment(segment.x0, segment.y0, segment.x1, segment.y1);
+    grid.thicken();
+    isochrone.boundaries = traceOutlines(grid);
+}
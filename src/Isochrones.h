@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ContractionHierarchy.h"
+#include "MapGraph.h"
+#include "pathfinding.h"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// everything reachable within a distance limit
+struct Isochrone {
+	double limit = 0.0;
+	std::vector<uint32_t> nodes{};     // reached nodes, in no particular order
+	std::vector<double> distances{};   // distance of every node in nodes
+	std::vector<Edge*> edges{};        // edges that can be driven to their end within the limit, for Model::createModelFromEdges
+	std::vector<std::vector<glm::vec2>> boundaries{}; // one concave outline per connected reached area, implicitly closed
+	SearchStats stats{};               // of the search alone, without the edges and outlines
+};
+
+// isochrones: bounded one-to-all distances from one or several sources, together with the edges they reach
+// and outlines around them. a small limit is answered by a Dijkstra that stops at the limit; once that has
+// settled a sizable part of the graph, a PHAST sweep (Delling et al.) takes over. the sweep runs an upward
+// search in the contraction hierarchy, then relaxes the downward arcs of every node from the most important
+// node down. nodes are renumbered in that order and the downward arcs stored by head, so the sweep reads its
+// arrays from front to back. batched sweeps carry the distances from LANES sources side by side, one cache
+// line per node, and relax them together with SIMD where available.
+// outlines trace the reached roads, thickened by a cell of a grid, so blocks enclosed by reached roads count
+// as reached; holes are not reported.
+// the hierarchy must outlive the engine; the sweeps go stale with it when the weights change, the bounded
+// Dijkstra does not
+class Isochrones {
+public:
+	static constexpr size_t LANES = 8;
+
+	// cellSize is the grid resolution of the outlines in map units; 0 picks half the mean edge length
+	Isochrones(MapGraph& graph, const ContractionHierarchy& hierarchy, double cellSize = 0.0);
+
+	Isochrones(const Isochrones&) = delete;
+	Isochrones& operator=(const Isochrones&) = delete;
+
+	// everything reachable from any of the sources within limit, by whichever of the two searches below is cheaper
+	Isochrone compute(const std::vector<uint32_t>& sources, double limit) const;
+
+	// one isochrone per source; the sources are swept LANES at a time, the batches in parallel
+	std::vector<Isochrone> computeEach(const std::vector<uint32_t>& sources, double limit, ThreadPool& pool) const;
+
+	// the searches compute picks between
+	Isochrone boundedDijkstra(const std::vector<uint32_t>& sources, double limit) const;
+	Isochrone sweep(const std::vector<uint32_t>& sources, double limit) const;
+
+	double cellSize() const { return outlineCellSize; }
+private:
+	// bounded Dijkstra filling the nodes and distances; false if it stopped after settling budget nodes
+	bool settle(const std::vector<uint32_t>& sources, double limit, size_t budget, Isochrone& isochrone) const;
+
+	// upward search and sweep filling the nodes and distances
+	void sweepDistances(const std::vector<uint32_t>& sources, double limit, Isochrone& isochrone) const;
+
+	// multi-source search in the upward graph, pruned at limit; writes the distances it settles to lane "lane"
+	// of labels, which holds "lanes" distances per sweep position
+	void upward(const std::vector<uint32_t>& sources, double limit, double* labels, size_t lanes, size_t lane, SearchStats& stats) const;
+
+	// fills the edges and outlines of an isochrone whose nodes and distances are set
+	void finish(Isochrone& isochrone) const;
+
+	MapGraph& graph;
+	const ContractionHierarchy& hierarchy;
+	double outlineCellSize;
+
+	// sweep order, from the most important node down
+	std::vector<uint32_t> order{};    // node at every position
+	std::vector<uint32_t> position{}; // position of every node
+
+	// downward arcs into the node at every position, as the position of their tail and their weight
+	std::vector<uint32_t> sweepOffsets{};
+	std::vector<uint32_t> sweepTails{};
+	std::vector<double> sweepWeights{};
+};
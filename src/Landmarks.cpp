@@ -0,0 +1,305 @@
+#include "Landmarks.h"
+
+#include "CacheFile.h"
+#include "PriorityQueue.h"
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+    // tables file: a LandmarkFileHeader, the landmark nodes, then the distance table, each padded to 8 bytes
+    constexpr char LANDMARK_FILE_MAGIC[8] = { 'T', 'P', 'V', 'L', 'M', 'A', 'R', 'K' };
+    constexpr uint32_t LANDMARK_FILE_VERSION = 1;
+    constexpr uint32_t LANDMARK_FILE_BYTE_ORDER = 0x01020304;
+
+    // roots of the avoid strategy's trees are random, but the same on every build
+    constexpr uint32_t SELECTION_SEED = 1;
+
+    struct LandmarkFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t nodeCount;
+        uint64_t weightsHash;
+        uint32_t landmarkCount;
+        uint32_t selection;
+        double quantum;
+        uint64_t payloadChecksum;
+    };
+
+    using cachefile::padded;
+    using cachefile::checksum;
+
+    // one-to-all Dijkstra from "root" over the forward edges, or over the reverse edges for the distances to
+    // root. "length" maps an edge id to its length. settled nodes are appended to order, and predecessor
+    // holds the node each one was reached from, when they are not null
+    template <typename Length>
+    void searchAll(const MapGraph& graph, uint32_t root, bool backward, const Length& length, std::vector<double>& distance,
+        std::vector<uint32_t>* predecessor = nullptr, std::vector<uint32_t>* order = nullptr) {
+        const GraphArray<uint32_t>& offsets = backward ? graph.reverseOffsets : graph.offsets;
+        const GraphArray<uint32_t>& adjacent = backward ? graph.reverseSources : graph.targets;
+
+        distance.assign(graph.nodeCount(), DBL_MAX);
+        if (predecessor) predecessor->assign(graph.nodeCount(), UINT32_MAX);
+        if (order) order->clear();
+
+        pathfinding::BinaryHeap queue{};
+        distance[root] = 0.0;
+        queue.push(root, 0.0);
+        while (!queue.empty()) {
+            const pathfinding::QueueEntry top = queue.pop();
+            const uint32_t v = top.node;
+            if (top.key > distance[v]) continue; // stale entry left behind by lazy deletion
+            if (order) order->push_back(v);
+
+            for (uint32_t slot = offsets[v]; slot < offsets[v + 1]; slot++) {
+                const uint32_t w = adjacent[slot];
+                const double newDist = top.key + length(backward ? graph.reverseEdges[slot] : slot);
+                if (newDist < distance[w]) {
+                    distance[w] = newDist;
+                    if (predecessor) (*predecessor)[w] = v;
+                    queue.push(w, newDist);
+                }
+            }
+        }
+    }
+}
+
+Landmarks::Potential::Potential(const Landmarks& landmarks, uint32_t node, int sign)
+    : table{ landmarks.distances.data() }, fixed{ landmarks.distances.data() + node * 2 * landmarks.count() },
+    count{ landmarks.count() }, quantum{ landmarks.distanceQuantum }, sign{ sign } {}
+
+double Landmarks::Potential::operator()(uint32_t node) const {
+    const uint16_t* entries = table + node * 2 * count;
+    int32_t best = 0;
+    for (size_t l = 0; l < count; l++) {
+        // towards t: d(L, t) - d(L, v) and d(v, L) - d(t, L); from s the same with the roles of the nodes swapped
+        if (entries[l] != UNREACHABLE && fixed[l] != UNREACHABLE)
+            best = std::max(best, sign * (static_cast<int32_t>(fixed[l]) - entries[l]));
+        if (entries[count + l] != UNREACHABLE && fixed[count + l] != UNREACHABLE)
+            best = std::max(best, sign * (static_cast<int32_t>(entries[count + l]) - fixed[count + l]));
+    }
+    return best * quantum;
+}
+
+Landmarks::Landmarks(const MapGraph& graph, ThreadPool& pool, size_t count, LandmarkSelection selection) {
+    build(graph, pool, count, selection);
+}
+
+Landmarks::Landmarks(const MapGraph& graph, ThreadPool& pool, const char* cacheLocation, size_t count, LandmarkSelection selection) {
+    if (load(cacheLocation, graph, count, selection)) return;
+    build(graph, pool, count, selection);
+    save(cacheLocation); // failing to write the cache only costs the next startup a build
+}
+
+void Landmarks::build(const MapGraph& graph, ThreadPool& pool, size_t count, LandmarkSelection selection) {
+    const size_t nodeCount = graph.nodeCount();
+    count = std::min(count, nodeCount);
+    selectedBy = selection;
+    weightsHash = checksum(reinterpret_cast<const char*>(graph.weights.data()), graph.edgeCount() * sizeof(double));
+    landmarkNodes.clear();
+
+    // exact distances from and to every landmark so far, to choose the next one
+    std::vector<std::vector<double>> fromLandmark{};
+    std::vector<std::vector<double>> toLandmark{};
+    std::vector<uint8_t> isLandmark(nodeCount, 0);
+    const auto weight = [&](uint32_t edge) { return graph.weights[edge]; };
+
+    // largest distance from the nearest landmark; nodes no landmark reaches come first
+    const auto farthestNode = [&]() {
+        uint32_t node = UINT32_MAX;
+        double farthest = -1.0;
+        for (uint32_t v = 0; v < nodeCount; v++) {
+            double nearest = DBL_MAX;
+            for (const std::vector<double>& distance : fromLandmark)
+                nearest = std::min(nearest, distance[v]);
+            if (!isLandmark[v] && nearest > farthest) {
+                farthest = nearest;
+                node = v;
+            }
+        }
+        return node;
+    };
+
+    // grows a shortest path tree from a random root and weighs every node by how far the landmarks
+    // underestimate its distance from the root. subtrees holding a landmark weigh nothing; the new landmark
+    // is the leaf reached by following the heaviest children down from the heaviest node. UINT32_MAX if the
+    // landmarks bound the whole tree exactly
+    std::mt19937 rng{ SELECTION_SEED };
+    std::vector<double> treeDistance{};
+    std::vector<uint32_t> treeParent{};
+    std::vector<uint32_t> treeOrder{};
+    std::vector<double> size(nodeCount, 0.0);
+    std::vector<uint32_t> heaviestChild(nodeCount, UINT32_MAX);
+    std::vector<uint8_t> blocked{};
+    const auto avoidNode = [&]() {
+        const uint32_t root = static_cast<uint32_t>(rng() % nodeCount);
+        searchAll(graph, root, false, weight, treeDistance, &treeParent, &treeOrder);
+        blocked = isLandmark;
+        for (auto it = treeOrder.rbegin(); it != treeOrder.rend(); ++it) {
+            const uint32_t v = *it;
+            double bound = 0.0;
+            for (size_t l = 0; l < landmarkNodes.size(); l++) {
+                if (fromLandmark[l][v] != DBL_MAX && fromLandmark[l][root] != DBL_MAX)
+                    bound = std::max(bound, fromLandmark[l][v] - fromLandmark[l][root]);
+                if (toLandmark[l][root] != DBL_MAX && toLandmark[l][v] != DBL_MAX)
+                    bound = std::max(bound, toLandmark[l][root] - toLandmark[l][v]);
+            }
+
+            // children come first in reverse settle order, so size[v] already holds theirs
+            size[v] = blocked[v] ? 0.0 : size[v] + std::max(0.0, treeDistance[v] - bound);
+            const uint32_t parent = treeParent[v];
+            if (parent == UINT32_MAX) continue;
+            if (blocked[v]) blocked[parent] = 1;
+            size[parent] += size[v];
+            if (heaviestChild[parent] == UINT32_MAX || size[v] > size[heaviestChild[parent]])
+                heaviestChild[parent] = v;
+        }
+
+        uint32_t leaf = UINT32_MAX;
+        double heaviest = 0.0;
+        for (uint32_t v : treeOrder) {
+            if (size[v] > heaviest) {
+                heaviest = size[v];
+                leaf = v;
+            }
+        }
+        while (leaf != UINT32_MAX && heaviestChild[leaf] != UINT32_MAX && size[heaviestChild[leaf]] > 0.0)
+            leaf = heaviestChild[leaf];
+        for (uint32_t v : treeOrder) {
+            size[v] = 0.0;
+            heaviestChild[v] = UINT32_MAX;
+        }
+        return leaf;
+    };
+
+    while (landmarkNodes.size() < count) {
+        uint32_t next = UINT32_MAX;
+        if (landmarkNodes.empty()) {
+            // the node farthest from a random one, for either strategy
+            searchAll(graph, static_cast<uint32_t>(rng() % nodeCount), false, weight, treeDistance);
+            double farthest = -1.0;
+            for (uint32_t v = 0; v < nodeCount; v++) {
+                if (treeDistance[v] != DBL_MAX && treeDistance[v] > farthest) {
+                    farthest = treeDistance[v];
+                    next = v;
+                }
+            }
+        } else {
+            if (selection == LandmarkSelection::Avoid)
+                next = avoidNode();
+            if (next == UINT32_MAX)
+                next = farthestNode();
+        }
+        if (next == UINT32_MAX || isLandmark[next]) break;
+
+        landmarkNodes.push_back(next);
+        isLandmark[next] = 1;
+        fromLandmark.emplace_back();
+        toLandmark.emplace_back();
+        searchAll(graph, next, false, weight, fromLandmark.back());
+        searchAll(graph, next, true, weight, toLandmark.back());
+    }
+
+    // one quantum for all landmarks, as fine as the longest distance allows
+    double longest = 0.0;
+    for (size_t l = 0; l < landmarkNodes.size(); l++) {
+        for (uint32_t v = 0; v < nodeCount; v++) {
+            if (fromLandmark[l][v] != DBL_MAX) longest = std::max(longest, fromLandmark[l][v]);
+            if (toLandmark[l][v] != DBL_MAX) longest = std::max(longest, toLandmark[l][v]);
+        }
+    }
+    distanceQuantum = longest > 0.0 ? longest / (UNREACHABLE - 1) : 1.0;
+    fromLandmark.clear();
+    toLandmark.clear();
+
+    // the stored distances are exact over the weights rounded down to whole quanta. bounds over lighter
+    // edges are feasible potentials for the real ones, which rounding the exact distances would not be
+    std::vector<double> quantized(graph.edgeCount());
+    for (uint32_t edge = 0; edge < graph.edgeCount(); edge++)
+        quantized[edge] = std::floor(graph.weights[edge] / distanceQuantum);
+
+    const size_t landmarkCount = landmarkNodes.size();
+    distances.assign(nodeCount * 2 * landmarkCount, UNREACHABLE);
+    pool.parallelFor(0, 2 * landmarkCount, 1, [&](size_t begin, size_t end) {
+        std::vector<double> distance{};
+        for (size_t i = begin; i < end; i++) {
+            const size_t l = i % landmarkCount;
+            const bool backward = i >= landmarkCount;
+            searchAll(graph, landmarkNodes[l], backward, [&](uint32_t edge) { return quantized[edge]; }, distance);
+            for (uint32_t v = 0; v < nodeCount; v++) {
+                if (distance[v] != DBL_MAX)
+                    distances[v * 2 * landmarkCount + i] = static_cast<uint16_t>(std::min<double>(distance[v], UNREACHABLE - 1));
+            }
+        }
+    });
+}
+
+bool Landmarks::save(const char* cacheLocation) const {
+    std::vector<char> payload(padded(landmarkNodes.size() * sizeof(uint32_t)) + padded(distances.size() * sizeof(uint16_t)), 0);
+    if (!landmarkNodes.empty())
+        std::memcpy(payload.data(), landmarkNodes.data(), landmarkNodes.size() * sizeof(uint32_t));
+    if (!distances.empty())
+        std::memcpy(payload.data() + padded(landmarkNodes.size() * sizeof(uint32_t)), distances.data(), distances.size() * sizeof(uint16_t));
+
+    LandmarkFileHeader header{};
+    std::memcpy(header.magic, LANDMARK_FILE_MAGIC, sizeof(header.magic));
+    header.version = LANDMARK_FILE_VERSION;
+    header.byteOrder = LANDMARK_FILE_BYTE_ORDER;
+    header.nodeCount = landmarkNodes.empty() ? 0 : distances.size() / (2 * landmarkNodes.size());
+    header.weightsHash = weightsHash;
+    header.landmarkCount = static_cast<uint32_t>(landmarkNodes.size());
+    header.selection = static_cast<uint32_t>(selectedBy);
+    header.quantum = distanceQuantum;
+    header.payloadChecksum = checksum(payload.data(), payload.size());
+
+    std::ofstream file{ cacheLocation, std::ios::binary | std::ios::trunc };
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    return static_cast<bool>(file);
+}
+
+bool Landmarks::load(const char* cacheLocation, const MapGraph& graph, size_t count, LandmarkSelection selection) {
+    std::ifstream file{ cacheLocation, std::ios::binary };
+    if (!file) return false;
+
+    // only good for the same weights and the same request
+    LandmarkFileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    const size_t landmarkCount = std::min(count, graph.nodeCount());
+    const uint64_t hash = checksum(reinterpret_cast<const char*>(graph.weights.data()), graph.edgeCount() * sizeof(double));
+    if (std::memcmp(header.magic, LANDMARK_FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != LANDMARK_FILE_VERSION
+        || header.byteOrder != LANDMARK_FILE_BYTE_ORDER
+        || header.nodeCount != graph.nodeCount()
+        || header.weightsHash != hash
+        || header.landmarkCount != landmarkCount
+        || header.selection != static_cast<uint32_t>(selection)
+        || !(header.quantum > 0.0))
+        return false;
+
+    std::vector<char> payload(padded(landmarkCount * sizeof(uint32_t)) + padded(graph.nodeCount() * 2 * landmarkCount * sizeof(uint16_t)));
+    if (!file.read(payload.data(), static_cast<std::streamsize>(payload.size())) || file.peek() != std::ifstream::traits_type::eof()
+        || checksum(payload.data(), payload.size()) != header.payloadChecksum)
+        return false;
+
+    std::vector<uint32_t> nodes(landmarkCount);
+    std::memcpy(nodes.data(), payload.data(), landmarkCount * sizeof(uint32_t));
+    if (std::any_of(nodes.begin(), nodes.end(), [&](uint32_t node) { return node >= graph.nodeCount(); }))
+        return false;
+
+    landmarkNodes = std::move(nodes);
+    distances.resize(graph.nodeCount() * 2 * landmarkCount);
+    std::memcpy(distances.data(), payload.data() + padded(landmarkCount * sizeof(uint32_t)), distances.size() * sizeof(uint16_t));
+    distanceQuantum = header.quantum;
+    selectedBy = selection;
+    weightsHash = hash;
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "MapGraph.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// how Landmarks picks its landmarks
+enum class LandmarkSelection {
+	Farthest, // each landmark is the node farthest from the ones chosen so far
+	Avoid     // each landmark is a leaf below the part of a random shortest path tree the current landmarks bound worst (Goldberg and Werneck)
+};
+
+// distance tables for ALT: A*, landmarks and the triangle inequality (Goldberg and Harrelson). the distances
+// from a landmark L to every node and from every node to L bound any distance from below, since
+// d(v, t) >= d(L, t) - d(L, v) and d(v, t) >= d(v, L) - d(t, L). unlike the straight-line distance this holds
+// for any non-negative weights, travel times included.
+// distances are stored as 16 bit multiples of one quantum, computed over the edge weights rounded down to
+// whole quanta, so the bounds stay consistent. a node's entries for all landmarks are adjacent, so a
+// potential evaluation reads one or two cache lines. the bounds remain valid while no edge weight drops
+// below the weight the tables were built from, so traffic that only slows edges down keeps them usable.
+class Landmarks {
+public:
+	static constexpr size_t DEFAULT_COUNT = 16;
+	static constexpr uint16_t UNREACHABLE = UINT16_MAX;
+
+	// consistent lower bound on the distance from every node to a fixed target, or from a fixed source
+	class Potential {
+	public:
+		double operator()(uint32_t node) const;
+	private:
+		friend class Landmarks;
+		Potential(const Landmarks& landmarks, uint32_t node, int sign);
+
+		const uint16_t* table;
+		const uint16_t* fixed; // entries of the fixed node
+		size_t count;
+		double quantum;
+		int sign; // 1 for bounds towards the fixed node, -1 for bounds from it
+	};
+
+	Landmarks(const MapGraph& graph, ThreadPool& pool, size_t count = DEFAULT_COUNT, LandmarkSelection selection = LandmarkSelection::Avoid);
+
+	// loads the tables from the cache if they were written for a graph with the same weights and the same
+	// count and selection, otherwise builds them and writes the cache for next time
+	Landmarks(const MapGraph& graph, ThreadPool& pool, const char* cacheLocation, size_t count = DEFAULT_COUNT,
+		LandmarkSelection selection = LandmarkSelection::Avoid);
+
+	Landmarks(const Landmarks&) = delete;
+	Landmarks& operator=(const Landmarks&) = delete;
+
+	// writes the tables; returns false if the file cannot be written
+	bool save(const char* cacheLocation) const;
+
+	Potential potentialTo(uint32_t target) const { return { *this, target, 1 }; }
+	Potential potentialFrom(uint32_t source) const { return { *this, source, -1 }; }
+
+	size_t count() const { return landmarkNodes.size(); }
+	const std::vector<uint32_t>& nodes() const { return landmarkNodes; }
+	double quantum() const { return distanceQuantum; }
+	size_t tableBytes() const { return distances.size() * sizeof(uint16_t); }
+private:
+	void build(const MapGraph& graph, ThreadPool& pool, size_t count, LandmarkSelection selection);
+	bool load(const char* cacheLocation, const MapGraph& graph, size_t count, LandmarkSelection selection);
+
+	std::vector<uint32_t> landmarkNodes{};
+	// per node, the distance from every landmark followed by the distance to every landmark, in quanta
+	std::vector<uint16_t> distances{};
+	double distanceQuantum = 1.0;
+	LandmarkSelection selectedBy = LandmarkSelection::Avoid;
+	uint64_t weightsHash = 0; // of the weights the tables were built from
+};
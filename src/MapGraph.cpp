@@ -1,77 +1,493 @@
-#pragma once
-
 #include "MapGraph.h"
-#include "../lib/tinyxml2.h"
+#include "CacheFile.h"
+#include "GraphPartition.h"
+#include "OsmReader.h"
+#include "WayTags.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+    // binary graph cache layout: a GraphFileHeader followed by every array in forEachArray order,
+    // each padded to a multiple of 8 bytes so all of them are naturally aligned in the mapping
+    constexpr char GRAPH_FILE_MAGIC[8] = { 'T', 'P', 'V', 'G', 'R', 'A', 'P', 'H' };
+    constexpr uint32_t GRAPH_FILE_VERSION = 4; // 2: non-routable ways and their nodes dropped, 3: nodes numbered by cell, 4: turn tables
+    constexpr uint32_t GRAPH_FILE_BYTE_ORDER = 0x01020304; // reads back differently on a machine of the other endianness
+
+    struct GraphFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t nodeCount;
+        uint64_t edgeCount;
+        uint64_t cellCount;
+        uint64_t boundaryNodeCount;
+        uint64_t turnTableBytes;
+        uint64_t payloadSize;
+        uint64_t payloadChecksum;
+    };
+
+    using cachefile::padded;
+    using cachefile::checksum;
+
+    // largest cell of MapGraph's partition, and the smaller cells that only order the nodes inside it
+    constexpr uint32_t CELL_SIZE = 1024;
+    constexpr uint32_t LOCALITY_CELL_SIZE = 64;
+
+    // turns sharper than this either way are left or right turns, the rest go straight on
+    constexpr double STRAIGHT_ANGLE = 0.7853981633974483; // 45 degrees
+
+    // kind of the turn u -> v -> w by its angle; y grows southwards, so a clockwise turn is to the right
+    TurnType classifyTurn(const MapGraph& graph, uint32_t u, uint32_t v, uint32_t w) {
+        if (u == w) return TurnType::UTurn;
+        const double inX = graph.xs[v] - graph.xs[u];
+        const double inY = graph.ys[v] - graph.ys[u];
+        const double outX = graph.xs[w] - graph.xs[v];
+        const double outY = graph.ys[w] - graph.ys[v];
+        const double angle = std::atan2(inX * outY - inY * outX, inX * outX + inY * outY);
+        if (std::abs(angle) <= STRAIGHT_ANGLE) return TurnType::Straight;
+        return angle > 0.0 ? TurnType::Right : TurnType::Left;
+    }
+
+    // calls f(array, count) for every array stored in the cache, in file order
+    template <typename Graph, typename F>
+    void forEachArray(Graph& graph, size_t nodeCount, size_t edgeCount, size_t cellCount, size_t boundaryNodeCount, size_t turnTableBytes, F&& f) {
+        f(graph.offsets, nodeCount + 1);
+        f(graph.targets, edgeCount);
+        f(graph.weights, edgeCount);
+        f(graph.sources, edgeCount);
+        f(graph.reverseOffsets, nodeCount + 1);
+        f(graph.reverseSources, edgeCount);
+        f(graph.reverseEdges, edgeCount);
+        f(graph.xs, nodeCount);
+        f(graph.ys, nodeCount);
+        f(graph.nodeOsmIds, nodeCount);
+        f(graph.edgeWayIds, edgeCount);
+        f(graph.cellOffsets, cellCount + 1);
+        f(graph.nodeCells, nodeCount);
+        f(graph.boundaryOffsets, cellCount + 1);
+        f(graph.boundaryNodes, boundaryNodeCount);
+        f(graph.reverseSlots, edgeCount);
+        f(graph.turnTableOffsets, nodeCount);
+        f(graph.turnTables, turnTableBytes);
+    }
+
+    // size and modification time of the OSM file, or false if it cannot be read
+    bool sourceStamp(const char* path, uint64_t& size, int64_t& time) {
+        std::error_code error{};
+        size = std::filesystem::file_size(path, error);
+        if (error) return false;
+        time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+        return !error;
+    }
+}
 
 MapGraph::MapGraph(const char* osmFileLocation) : nodes{}, edges{} {
+    parse(osmFileLocation);
+}
+
+MapGraph::MapGraph(const char* osmFileLocation, const char* cacheLocation) : nodes{}, edges{} {
+    if (load(cacheLocation, osmFileLocation)) return;
+    parse(osmFileLocation);
+    save(cacheLocation); // failing to write the cache only costs the next startup a parse
+}
+
+void MapGraph::parse(const char* osmFileLocation) {
     // used to map node ids from file into more efficient indexes
-    std::unordered_map<size_t, size_t> idToIndex{};
-
-    // load map data from XML style file
-    tinyxml2::XMLDocument doc{};
-    doc.LoadFile(osmFileLocation);
-    tinyxml2::XMLElement* root = doc.FirstChildElement("osm");
-    
-    // iterate through nodes
-    for (tinyxml2::XMLElement* element = root->FirstChildElement("node"); element; element = element->NextSiblingElement("node")) {
-        size_t id = std::stoll(element->Attribute("id")); // node id
-        double x = atof(element->Attribute("lon")); // longitude
-        double y = atof(element->Attribute("lat")); // latitude
-
-        // create node
-        Node* newNode = new Node{ idToIndex.size(), (x + 82.3535) * 150, (y - 29.6465) * -150 }; // preprocessing; offset & scale the data
-        idToIndex[id] = newNode->id;
-        nodes.push_back(newNode);
-    }
-
-    // initialize adjacency list
-    for (size_t i = 0; i < nodes.size(); i++)
-        adjacencyList[nodes[i]] = {};
-
-    // iterate through edges ("ways")
-    for (tinyxml2::XMLElement* element = root->FirstChildElement("way"); element; element = element->NextSiblingElement("way")) {
-        std::vector<size_t> node_refs{};
-        for (tinyxml2::XMLElement* nd = element->FirstChildElement("nd"); nd; nd = nd->NextSiblingElement("nd")) {
-            size_t ref = std::stoll(nd->Attribute("ref"));
-            node_refs.push_back(ref);
-        }
+    std::unordered_map<uint64_t, uint32_t> idToIndex{};
+    std::vector<double> nodeXs{};
+    std::vector<double> nodeYs{};
+    std::vector<uint64_t> osmIds{};
+    std::vector<RawEdge> rawEdges{};
+    std::vector<RawRestriction> restrictions{};
+
+    // stream the XML style file; nodes and ways go straight into the builder as they are parsed
+    OsmReader reader{};
+    reader.onNode = [&](uint64_t id, double lat, double lon) {
+        // create node; preprocessing, offset & scale the data
+        idToIndex[id] = static_cast<uint32_t>(osmIds.size());
+        nodeXs.push_back((lon + 82.3535) * 150);
+        nodeYs.push_back((lat - 29.6465) * -150);
+        osmIds.push_back(id);
+    };
+    reader.onWay = [&](uint64_t id, const std::vector<uint64_t>& refs, const std::vector<OsmTag>& tags) {
+        // buildings, footways, private roads etc. never become edges
+        const WayTags way = WayTags::parse(tags);
+        if (!way.routable()) return;
 
-        // check if edge is directed or undirected
-        bool oneway = false;
-        for (tinyxml2::XMLElement* t = element->FirstChildElement("tag"); t; t = t->NextSiblingElement("tag")) {
-            if (t->Attribute("k") != "oneway") continue;
-            if (t->Attribute("v") == "yes")
-                oneway = true;
-        }
         // a "way" can have many, many, nodes. separate "way" into multiple edges, composed of two nodes each.
-        for (size_t i = 0; i < node_refs.size() - 1; i++) {
-            Node* from{ nodes[idToIndex[node_refs[i]]] };
-            Node* to{ nodes[idToIndex[node_refs[i + 1]]] };
+        for (size_t i = 0; i + 1 < refs.size(); i++) {
+            auto fromIt = idToIndex.find(refs[i]);
+            auto toIt = idToIndex.find(refs[i + 1]);
+            if (fromIt == idToIndex.end() || toIt == idToIndex.end()) continue; // node outside the extract
+            const uint32_t from = fromIt->second;
+            const uint32_t to = toIt->second;
             if (from == to) continue;
 
             // weight determined from latitude & longitude distance
-            const double dist = std::sqrt((from->x - to->x) * (from->x - to->x) + (from->y - to->y) * (from->y - to->y));
+            const double dx = nodeXs[from] - nodeXs[to];
+            const double dy = nodeYs[from] - nodeYs[to];
+            const double dist = std::sqrt(dx * dx + dy * dy);
+
+            // create edges in the directions the way can be driven
+            if (way.oneway != Oneway::Backward)
+                rawEdges.push_back({ from, to, dist, id });
+            if (way.oneway != Oneway::Forward)
+                rawEdges.push_back({ to, from, dist, id });
+        }
+    };
 
-            // create edge
-            Edge* newEdge = new Edge{ from, to, dist };
-            edges.push_back(newEdge);
+    reader.onRelation = [&](uint64_t /*id*/, const std::vector<OsmMember>& members, const std::vector<OsmTag>& tags) {
+        const Restriction restriction = parseRestriction(tags);
+        if (restriction == Restriction::None) return;
 
-            adjacencyList[from].push_back(newEdge);
-            if (!oneway) { // if undirected, create second edge going opposite direction
-                Edge* newEdgeOpposite = new Edge{ to, from, dist };
-                edges.push_back(newEdgeOpposite);
-                adjacencyList[to].push_back(newEdgeOpposite);
+        // no_entry and no_exit may list several "from" or "to" ways; via ways are not supported
+        std::vector<uint64_t> fromWays{};
+        std::vector<uint64_t> toWays{};
+        uint64_t via = 0;
+        size_t vias = 0;
+        for (const OsmMember& member : members) {
+            if (member.role == "from" && member.type == "way") fromWays.push_back(member.ref);
+            else if (member.role == "to" && member.type == "way") toWays.push_back(member.ref);
+            else if (member.role == "via") {
+                vias++;
+                if (member.type == "node") via = member.ref;
             }
         }
+        if (vias != 1 || via == 0) return;
+        for (uint64_t fromWay : fromWays) {
+            for (uint64_t toWay : toWays)
+                restrictions.push_back({ fromWay, via, toWay, restriction == Restriction::Only });
+        }
+    };
+
+    if (!reader.read(osmFileLocation))
+        throw std::runtime_error(std::string{ "failed to open map file " } + osmFileLocation + "!");
+    sourceStamp(osmFileLocation, sourceSize, sourceTime);
+
+    // keep only nodes that ended up on a routable way, renumbered in file order
+    std::vector<uint32_t> newIndex(osmIds.size(), UINT32_MAX);
+    for (const RawEdge& raw : rawEdges) {
+        newIndex[raw.from] = 0;
+        newIndex[raw.to] = 0;
     }
+    uint32_t kept = 0;
+    for (size_t i = 0; i < osmIds.size(); i++) {
+        if (newIndex[i] == UINT32_MAX) continue;
+        newIndex[i] = kept;
+        nodeXs[kept] = nodeXs[i];
+        nodeYs[kept] = nodeYs[i];
+        osmIds[kept] = osmIds[i];
+        kept++;
+    }
+    nodeXs.resize(kept);
+    nodeYs.resize(kept);
+    osmIds.resize(kept);
+    for (RawEdge& raw : rawEdges) {
+        raw.from = newIndex[raw.from];
+        raw.to = newIndex[raw.to];
+    }
+
+    xs = std::move(nodeXs);
+    ys = std::move(nodeYs);
+    nodeOsmIds = std::move(osmIds);
+    build(rawEdges);
+    partition(rawEdges);
+    buildTurnTables(restrictions);
+    buildAdapters();
 }
 
-MapGraph::~MapGraph() {
-    for (size_t i = 0; i < nodes.size(); i++)
-        delete nodes[i];
-    for (size_t i = 0; i < edges.size(); i++)
-        delete edges[i];
-}
\ No newline at end of file
+void MapGraph::build(const std::vector<RawEdge>& rawEdges) {
+    const size_t nodeCount = xs.size();
+
+    // counting sort of edges by source node; csrOffsets[u + 1] first holds the out-degree of u
+    std::vector<uint32_t> csrOffsets(nodeCount + 1, 0);
+    for (const RawEdge& raw : rawEdges)
+        csrOffsets[raw.from + 1]++;
+    for (size_t i = 0; i < nodeCount; i++)
+        csrOffsets[i + 1] += csrOffsets[i];
+
+    std::vector<uint32_t> cursor(csrOffsets.begin(), csrOffsets.end() - 1);
+    std::vector<uint32_t> csrTargets(rawEdges.size());
+    std::vector<double> csrWeights(rawEdges.size());
+    std::vector<uint32_t> csrSources(rawEdges.size());
+    std::vector<uint64_t> wayIds(rawEdges.size());
+    for (const RawEdge& raw : rawEdges) {
+        const uint32_t slot = cursor[raw.from]++;
+        csrTargets[slot] = raw.to;
+        csrWeights[slot] = raw.weight;
+        csrSources[slot] = raw.from;
+        wayIds[slot] = raw.way;
+    }
+
+    // reverse adjacency for backward searches, built the same way keyed by target node
+    std::vector<uint32_t> inOffsets(nodeCount + 1, 0);
+    for (uint32_t target : csrTargets)
+        inOffsets[target + 1]++;
+    for (size_t i = 0; i < nodeCount; i++)
+        inOffsets[i + 1] += inOffsets[i];
+
+    cursor.assign(inOffsets.begin(), inOffsets.end() - 1);
+    std::vector<uint32_t> inSources(csrTargets.size());
+    std::vector<uint32_t> inEdges(csrTargets.size());
+    for (uint32_t u = 0; u < nodeCount; u++) {
+        for (uint32_t slot = csrOffsets[u]; slot < csrOffsets[u + 1]; slot++) {
+            const uint32_t reverseSlot = cursor[csrTargets[slot]]++;
+            inSources[reverseSlot] = u;
+            inEdges[reverseSlot] = slot;
+        }
+    }
+
+    offsets = std::move(csrOffsets);
+    targets = std::move(csrTargets);
+    weights = std::move(csrWeights);
+    sources = std::move(csrSources);
+    edgeWayIds = std::move(wayIds);
+    reverseOffsets = std::move(inOffsets);
+    reverseSources = std::move(inSources);
+    reverseEdges = std::move(inEdges);
+}
+
+void MapGraph::partition(std::vector<RawEdge>& rawEdges) {
+    std::vector<uint32_t> newIndex(nodeCount());
+    std::vector<uint32_t> cells(nodeCount());
+    std::vector<uint32_t> offsetsOfCells{ 0 };
+    {
+        const GraphPartition cellPartition{ *this, { LOCALITY_CELL_SIZE, CELL_SIZE } };
+        const std::vector<uint32_t>& order = cellPartition.order();
+        for (uint32_t i = 0; i < order.size(); i++) {
+            newIndex[order[i]] = i;
+            cells[i] = cellPartition.cell(1, order[i]);
+            if (cells[i] == offsetsOfCells.size()) offsetsOfCells.push_back(i);
+        }
+        offsetsOfCells.push_back(static_cast<uint32_t>(order.size()));
+        if (order.empty()) offsetsOfCells.pop_back();
+    }
+
+    std::vector<double> nodeXs(nodeCount());
+    std::vector<double> nodeYs(nodeCount());
+    std::vector<uint64_t> osmIds(nodeCount());
+    for (uint32_t v = 0; v < nodeCount(); v++) {
+        nodeXs[newIndex[v]] = xs[v];
+        nodeYs[newIndex[v]] = ys[v];
+        osmIds[newIndex[v]] = nodeOsmIds[v];
+    }
+    for (RawEdge& raw : rawEdges) {
+        raw.from = newIndex[raw.from];
+        raw.to = newIndex[raw.to];
+    }
+    xs = std::move(nodeXs);
+    ys = std::move(nodeYs);
+    nodeOsmIds = std::move(osmIds);
+    build(rawEdges);
+
+    // boundary nodes come out grouped by cell since cells are id ranges
+    std::vector<uint32_t> offsetsOfBoundaries{ 0 };
+    std::vector<uint32_t> boundary{};
+    for (uint32_t c = 0; c + 1 < offsetsOfCells.size(); c++) {
+        for (uint32_t v = offsetsOfCells[c]; v < offsetsOfCells[c + 1]; v++) {
+            bool crossing = false;
+            for (uint32_t slot = offsets[v]; slot < offsets[v + 1] && !crossing; slot++)
+                crossing = cells[targets[slot]] != c;
+            for (uint32_t slot = reverseOffsets[v]; slot < reverseOffsets[v + 1] && !crossing; slot++)
+                crossing = cells[reverseSources[slot]] != c;
+            if (crossing) boundary.push_back(v);
+        }
+        offsetsOfBoundaries.push_back(static_cast<uint32_t>(boundary.size()));
+    }
+
+    cellOffsets = std::move(offsetsOfCells);
+    nodeCells = std::move(cells);
+    boundaryOffsets = std::move(offsetsOfBoundaries);
+    boundaryNodes = std::move(boundary);
+}
+
+void MapGraph::buildTurnTables(const std::vector<RawRestriction>& restrictions) {
+    std::vector<uint32_t> slotsInReverse(edgeCount());
+    for (uint32_t slot = 0; slot < edgeCount(); slot++)
+        slotsInReverse[reverseEdges[slot]] = slot;
+
+    // restrictions grouped by the index of their via node; those whose via node was dropped are ignored
+    std::unordered_map<uint64_t, uint32_t> viaIndex{};
+    for (const RawRestriction& restriction : restrictions)
+        viaIndex.emplace(restriction.viaNode, UINT32_MAX);
+    for (uint32_t v = 0; v < nodeCount(); v++) {
+        auto it = viaIndex.find(nodeOsmIds[v]);
+        if (it != viaIndex.end()) it->second = v;
+    }
+    std::vector<std::pair<uint32_t, const RawRestriction*>> byNode{};
+    for (const RawRestriction& restriction : restrictions) {
+        const uint32_t v = viaIndex[restriction.viaNode];
+        if (v != UINT32_MAX) byNode.push_back({ v, &restriction });
+    }
+    std::sort(byNode.begin(), byNode.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<uint8_t> tables{};
+    std::vector<uint32_t> tableOffsets(nodeCount());
+    std::unordered_map<std::string, uint32_t> shared{};
+    std::string table{};
+    auto restriction = byNode.begin();
+    for (uint32_t v = 0; v < nodeCount(); v++) {
+        const uint32_t inBegin = reverseOffsets[v];
+        const uint32_t inCount = reverseOffsets[v + 1] - inBegin;
+        const uint32_t outBegin = offsets[v];
+        const uint32_t outCount = offsets[v + 1] - outBegin;
+        table.assign(static_cast<size_t>(inCount) * outCount, 0);
+        for (uint32_t i = 0; i < inCount; i++) {
+            for (uint32_t j = 0; j < outCount; j++)
+                table[i * outCount + j] = static_cast<char>(classifyTurn(*this, reverseSources[inBegin + i], v, targets[outBegin + j]));
+        }
+
+        // a restriction applies to the edges of its "from" way entering v and of its "to" way leaving it; a
+        // no_u_turn names the same way twice, and then only the way back counts
+        for (; restriction != byNode.end() && restriction->first == v; ++restriction) {
+            const RawRestriction& rule = *restriction->second;
+            for (uint32_t i = 0; i < inCount; i++) {
+                const uint32_t in = reverseEdges[inBegin + i];
+                if (edgeWayIds[in] != rule.fromWay) continue;
+                const auto matches = [&](uint32_t j) {
+                    return edgeWayIds[outBegin + j] == rule.toWay && (rule.fromWay != rule.toWay || targets[outBegin + j] == sources[in]);
+                };
+
+                // an only_* whose "to" way is missing from the extract is dropped rather than closing the junction
+                bool found = false;
+                for (uint32_t j = 0; j < outCount; j++)
+                    found = found || matches(j);
+                for (uint32_t j = 0; j < outCount; j++) {
+                    if (rule.only ? found && !matches(j) : matches(j))
+                        table[i * outCount + j] = static_cast<char>(TurnType::Forbidden);
+                }
+            }
+        }
+
+        const auto inserted = shared.emplace(table, static_cast<uint32_t>(tables.size()));
+        if (inserted.second)
+            tables.insert(tables.end(), table.begin(), table.end());
+        tableOffsets[v] = inserted.first->second;
+    }
+
+    reverseSlots = std::move(slotsInReverse);
+    turnTableOffsets = std::move(tableOffsets);
+    turnTables = std::move(tables);
+}
+
+void MapGraph::buildAdapters() {
+    nodeData.resize(nodeCount());
+    for (size_t i = 0; i < nodeData.size(); i++)
+        nodeData[i] = { i, xs[i], ys[i] };
+
+    edgeData.resize(edgeCount());
+    for (uint32_t slot = 0; slot < edgeData.size(); slot++)
+        edgeData[slot] = { &nodeData[sources[slot]], &nodeData[targets[slot]], weights[slot], slot };
+
+    // pointer adapters
+    nodes.resize(nodeData.size());
+    for (size_t i = 0; i < nodeData.size(); i++)
+        nodes[i] = &nodeData[i];
+    edges.resize(edgeData.size());
+    for (size_t i = 0; i < edgeData.size(); i++)
+        edges[i] = &edgeData[i];
+}
+
+void MapGraph::updateWeights(const std::vector<WeightUpdate>& updates) {
+    for (const WeightUpdate& update : updates) {
+        if (update.edge >= edgeCount() || !(update.weight >= 0.0) || !std::isfinite(update.weight))
+            throw std::runtime_error("invalid edge weight update!");
+    }
+
+    for (const WeightUpdate& update : updates) {
+        weights[update.edge] = update.weight;
+        edgeData[update.edge].weight = update.weight;
+    }
+    weightsRevision++;
+}
+
+bool MapGraph::save(const char* cacheLocation) const {
+    // assemble the payload first so its checksum can go in the header
+    std::vector<char> payload{};
+    forEachArray(*this, nodeCount(), edgeCount(), cellCount(), boundaryNodes.size(), turnTables.size(), [&](const auto& array, size_t) {
+        const size_t bytes = array.size() * sizeof(array[0]);
+        const size_t begin = payload.size();
+        payload.resize(begin + padded(bytes), 0);
+        if (bytes > 0)
+            std::memcpy(payload.data() + begin, array.data(), bytes);
+    });
+
+    GraphFileHeader header{};
+    std::memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FILE_VERSION;
+    header.byteOrder = GRAPH_FILE_BYTE_ORDER;
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.nodeCount = nodeCount();
+    header.edgeCount = edgeCount();
+    header.cellCount = cellCount();
+    header.boundaryNodeCount = boundaryNodes.size();
+    header.turnTableBytes = turnTables.size();
+    header.payloadSize = payload.size();
+    header.payloadChecksum = checksum(payload.data(), payload.size());
+
+    std::ofstream file{ cacheLocation, std::ios::binary | std::ios::trunc };
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    return static_cast<bool>(file);
+}
+
+bool MapGraph::load(const char* cacheLocation, const char* osmFileLocation) {
+    // the cache is only good for the exact OSM file it was built from
+    uint64_t size = 0;
+    int64_t time = 0;
+    if (!sourceStamp(osmFileLocation, size, time)) return false;
+    if (!mapping.open(cacheLocation, true)) return false;
+
+    GraphFileHeader header{};
+    bool valid = mapping.size() >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, mapping.begin(), sizeof(header));
+        valid = std::memcmp(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic)) == 0
+            && header.version == GRAPH_FILE_VERSION
+            && header.byteOrder == GRAPH_FILE_BYTE_ORDER
+            && header.sourceSize == size
+            && header.sourceTime == time;
+    }
+
+    // every array must fit exactly; counts come from the file, so check before trusting them
+    size_t expected = 0;
+    valid = valid && header.nodeCount < UINT32_MAX && header.edgeCount < UINT32_MAX
+        && header.cellCount <= header.nodeCount && header.boundaryNodeCount <= header.nodeCount && header.turnTableBytes < UINT32_MAX;
+    if (valid) {
+        forEachArray(*this, header.nodeCount, header.edgeCount, header.cellCount, header.boundaryNodeCount, header.turnTableBytes, [&](auto& array, size_t count) {
+            expected += padded(count * sizeof(array[0]));
+        });
+        valid = header.payloadSize == expected && mapping.size() - sizeof(header) == expected
+            && checksum(mapping.begin() + sizeof(header), expected) == header.payloadChecksum;
+    }
+
+    if (!valid) {
+        mapping.close();
+        return false;
+    }
+
+    // zero-copy; the arrays point straight into the mapping
+    char* cursor = mapping.begin() + sizeof(header);
+    forEachArray(*this, header.nodeCount, header.edgeCount, header.cellCount, header.boundaryNodeCount, header.turnTableBytes, [&](auto& array, size_t count) {
+        using T = std::remove_reference_t<decltype(array[0])>;
+        array.view(reinterpret_cast<T*>(cursor), count);
+        cursor += padded(count * sizeof(T));
+    });
+    sourceSize = size;
+    sourceTime = time;
+
+    buildAdapters();
+    return true;
+}
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <unordered_map>
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 struct Node {
@@ -13,14 +16,182 @@ struct Edge {
     Node* from;
     Node* to;
     double weight;
+    size_t id;
+};
+
+// new weight for one edge, e.g. from a live traffic feed
+struct WeightUpdate {
+    uint32_t edge;
+    double weight;
 };
 
+// kind of a turn from an incoming to an outgoing edge of a node; Forbidden marks turn restrictions
+enum class TurnType : uint8_t {
+    Straight,
+    Right,
+    Left,
+    UTurn, // back to the node the incoming edge came from
+    Forbidden
+};
+
+// contiguous array that either owns its elements or views them inside a mapped graph file.
+// indexing and data() behave like std::vector either way, so searches never care where it came from.
+template <typename T>
+class GraphArray {
+public:
+    GraphArray() = default;
+
+    GraphArray(const GraphArray&) = delete;
+    GraphArray& operator=(const GraphArray&) = delete;
+
+    GraphArray& operator=(std::vector<T>&& values) {
+        owned = std::move(values);
+        items = owned.data();
+        count = owned.size();
+        return *this;
+    }
+
+    void view(T* mapped, size_t size) {
+        owned = {};
+        items = mapped;
+        count = size;
+    }
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](size_t index) { return items[index]; }
+    const T& operator[](size_t index) const { return items[index]; }
+
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    const T& back() const { return items[count - 1]; }
+private:
+    std::vector<T> owned{};
+    T* items = nullptr;
+    size_t count = 0;
+};
+
+// road network stored in compressed sparse row (CSR) form.
+// outgoing edges of node u occupy slots [offsets[u], offsets[u + 1]) of the targets/weights arrays,
+// and edges are sorted by source so that slot i is also edges[i]. the Node/Edge pointer vectors
+// are kept as an adapter for code that consumes edges directly (e.g. Model::createModelFromEdges).
 struct MapGraph {
+    // adapter views into nodeData/edgeData
     std::vector<Node*> nodes;
     std::vector<Edge*> edges;
-    std::unordered_map<Node*, std::vector<Edge*>> adjacencyList;
 
+    // CSR adjacency
+    GraphArray<uint32_t> offsets; // size nodes.size() + 1
+    GraphArray<uint32_t> targets; // size edges.size()
+    GraphArray<double> weights;   // size edges.size()
+    GraphArray<uint32_t> sources; // source node of each slot, for edge-parallel sweeps
+
+    // reverse CSR adjacency; incoming edges of node v occupy slots [reverseOffsets[v], reverseOffsets[v + 1])
+    GraphArray<uint32_t> reverseOffsets; // size nodes.size() + 1
+    GraphArray<uint32_t> reverseSources; // source node of each incoming edge
+    GraphArray<uint32_t> reverseEdges;   // forward slot (edge id) of each incoming edge
+
+    // structure-of-arrays node coordinates
+    GraphArray<double> xs;
+    GraphArray<double> ys;
+
+    // ids in the source OSM file
+    GraphArray<uint64_t> nodeOsmIds; // size nodes.size()
+    GraphArray<uint64_t> edgeWayIds; // way each edge was cut from, size edges.size()
+
+    // partition into cells of nearby nodes, with few edges between cells. nodes are numbered cell by cell,
+    // so cell c is the id range [cellOffsets[c], cellOffsets[c + 1]) and a search that stays inside a few
+    // cells stays inside a few stretches of every per-node array
+    GraphArray<uint32_t> cellOffsets;     // size cellCount() + 1
+    GraphArray<uint32_t> nodeCells;       // cell of each node
+    GraphArray<uint32_t> boundaryOffsets; // size cellCount() + 1, into boundaryNodes
+    GraphArray<uint32_t> boundaryNodes;   // nodes with an edge from or to another cell, grouped by cell
+
+    // turns at node v form a table of one TurnType per pair of incoming and outgoing edge, a row per reverse
+    // slot in [reverseOffsets[v], reverseOffsets[v + 1]) and a column per slot in [offsets[v], offsets[v + 1]).
+    // nodes with equal tables share one copy, so the common junction shapes are stored once
+    GraphArray<uint32_t> reverseSlots;     // reverse slot of each edge, size edges.size()
+    GraphArray<uint32_t> turnTableOffsets; // start of each node's table in turnTables, size nodes.size()
+    GraphArray<uint8_t> turnTables;        // TurnType values
+
+    // parses an OSM XML file
     MapGraph(const char* osmFileLocation);
 
-    ~MapGraph();
-};
\ No newline at end of file
+    // opens the binary graph cache if it was written from the current version of the OSM file, otherwise
+    // parses the OSM file and writes the cache for next time
+    MapGraph(const char* osmFileLocation, const char* cacheLocation);
+
+    MapGraph(const MapGraph&) = delete;
+    MapGraph& operator=(const MapGraph&) = delete;
+
+    // writes the binary graph cache; returns false if the file cannot be written
+    bool save(const char* cacheLocation) const;
+
+    // changes edge weights in place, without a reload; cached arrays are copy-on-write, so the cache file
+    // keeps the original weights. a weight below the edge's straight-line length breaks the A* potentials.
+    // nothing may search the graph meanwhile, and hierarchies or tables built from it go stale.
+    // throws if an update names a missing edge or a negative or non-finite weight, before changing anything
+    void updateWeights(const std::vector<WeightUpdate>& updates);
+
+    // bumped by every updateWeights call, so derived data can tell it is stale
+    uint64_t weightsVersion() const { return weightsRevision; }
+
+    size_t nodeCount() const { return offsets.size() - 1; }
+    size_t edgeCount() const { return targets.size(); }
+    size_t cellCount() const { return cellOffsets.size() - 1; }
+
+    // kind of the turn from edge "in" onto edge "out", which must leave the node "in" enters
+    TurnType turn(uint32_t in, uint32_t out) const {
+        const uint32_t v = targets[in];
+        return static_cast<TurnType>(turnTables[turnTableOffsets[v] + (reverseSlots[in] - reverseOffsets[v]) * (offsets[v + 1] - offsets[v])
+            + (out - offsets[v])]);
+    }
+private:
+    struct RawEdge {
+        uint32_t from;
+        uint32_t to;
+        double weight;
+        uint64_t way;
+    };
+
+    // restriction relation with a via node; ids are those of the OSM file
+    struct RawRestriction {
+        uint64_t fromWay;
+        uint64_t viaNode;
+        uint64_t toWay;
+        bool only; // only_* rather than no_*
+    };
+
+    void parse(const char* osmFileLocation);
+    bool load(const char* cacheLocation, const char* osmFileLocation);
+
+    // builds CSR arrays from an unsorted edge list, once xs/ys/nodeOsmIds are set
+    void build(const std::vector<RawEdge>& rawEdges);
+
+    // partitions the graph built from rawEdges, renumbers its nodes cell by cell and builds it again;
+    // edge ids change with the node ids
+    void partition(std::vector<RawEdge>& rawEdges);
+
+    // classifies every turn by its angle and applies the restrictions, once the node ids are final
+    void buildTurnTables(const std::vector<RawRestriction>& restrictions);
+
+    // builds nodeData/edgeData and the pointer adapters from the CSR arrays
+    void buildAdapters();
+
+    std::vector<Node> nodeData;
+    std::vector<Edge> edgeData;
+
+    // identifies the OSM file the graph was built from, so a stale cache is never loaded
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+
+    // backing storage of the arrays when they were loaded from a cache; pages are copy-on-write
+    MappedFile mapping{};
+
+    uint64_t weightsRevision = 0;
+};
@@ -0,0 +1,99 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const char* path, bool copyOnWrite) {
+    close();
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    fileHandle = file;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        close();
+        return false;
+    }
+    mappedSize = static_cast<size_t>(size.QuadPart);
+    opened = true;
+    if (mappedSize == 0) return true; // empty files cannot be mapped
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        close();
+        return false;
+    }
+    mappingHandle = mapping;
+
+    data = static_cast<char*>(MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+    if (fileHandle != nullptr)
+        CloseHandle(fileHandle);
+    data = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    mappedSize = 0;
+    opened = false;
+}
+#else
+bool MappedFile::open(const char* path, bool copyOnWrite) {
+    close();
+
+    fileDescriptor = ::open(path, O_RDONLY);
+    if (fileDescriptor < 0) return false;
+
+    struct stat status{};
+    if (fstat(fileDescriptor, &status) != 0) {
+        close();
+        return false;
+    }
+    mappedSize = static_cast<size_t>(status.st_size);
+    opened = true;
+    if (mappedSize == 0) return true; // empty files cannot be mapped
+
+    void* mapping = mmap(nullptr, mappedSize, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    data = static_cast<char*>(mapping);
+    madvise(data, mappedSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != nullptr)
+        munmap(data, mappedSize);
+    if (fileDescriptor >= 0)
+        ::close(fileDescriptor);
+    data = nullptr;
+    fileDescriptor = -1;
+    mappedSize = 0;
+    opened = false;
+}
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+// std
+#include <cstddef>
+
+// memory mapping of a whole file, read-only or copy-on-write. the mapping lives as long as the object.
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// maps the file; returns false if it cannot be opened or mapped. with copyOnWrite the pages can
+	// be modified in memory without ever touching the file.
+	bool open(const char* path, bool copyOnWrite = false);
+	void close();
+
+	bool isOpen() const { return opened; }
+
+	char* begin() const { return data; }
+	char* end() const { return data + mappedSize; }
+	size_t size() const { return mappedSize; }
+private:
+	char* data = nullptr;
+	size_t mappedSize = 0;
+	bool opened = false;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fileDescriptor = -1;
+#endif
+};
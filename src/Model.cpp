@@ -138,9 +138,10 @@ std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescri
 
 // convert graph edges into triangles for rasterization
 void Model::Data::loadEdges(const std::vector<Edge*>& edges, glm::vec3 color, float width) {
-	vertices.reserve(edges.size() * 4);
-	indices.reserve(edges.size() * 6);
-	uint32_t index = 0;
+	// appends, so several edge sets can share one model
+	vertices.reserve(vertices.size() + edges.size() * 4);
+	indices.reserve(indices.size() + edges.size() * 6);
+	uint32_t index = static_cast<uint32_t>(vertices.size());
 	for (const auto& edge : edges) {
 		double x0 = edge->from->x;
 		double y0 = edge->from->y;
@@ -175,4 +176,33 @@ void Model::Data::loadEdges(const std::vector<Edge*>& edges, glm::vec3 color, fl
 
 		index += 4;
 	}
-}
\ No newline at end of file
+}
+
+void Model::Data::loadOutline(const std::vector<glm::vec2>& outline, glm::vec3 color, float width) {
+	vertices.reserve(vertices.size() + outline.size() * 4);
+	indices.reserve(indices.size() + outline.size() * 6);
+	uint32_t index = static_cast<uint32_t>(vertices.size());
+	for (size_t i = 0; i < outline.size(); i++) {
+		const glm::vec2 p0 = outline[i];
+		const glm::vec2 p1 = outline[(i + 1) % outline.size()];
+		if (p0 == p1) continue;
+
+		glm::vec2 dir = glm::normalize(p1 - p0);
+		glm::vec2 perp(-dir.y, dir.x);
+
+		vertices.push_back({ glm::vec3(p0 + perp * width, 0.f), color });
+		vertices.push_back({ glm::vec3(p0 - perp * width, 0.f), color });
+		vertices.push_back({ glm::vec3(p1 + perp * width, 0.f), color });
+		vertices.push_back({ glm::vec3(p1 - perp * width, 0.f), color });
+
+		indices.push_back(index);
+		indices.push_back(index + 1);
+		indices.push_back(index + 2);
+
+		indices.push_back(index + 2);
+		indices.push_back(index + 1);
+		indices.push_back(index + 3);
+
+		index += 4;
+	}
+}
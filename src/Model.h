@@ -38,6 +38,8 @@ public:
 		std::vector<std::unique_ptr<Texture>> textures{};
 
 		void loadEdges(const std::vector<Edge*>& edges, glm::vec3 color, float width);
+		// closed polygon outline, one quad per side
+		void loadOutline(const std::vector<glm::vec2>& outline, glm::vec3 color, float width);
 	};
 
 	Model(Device& device, const Model::Data& data);
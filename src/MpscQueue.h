@@ -0,0 +1,49 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <utility>
+
+// unbounded lock-free queue for many producers and a single consumer (Vyukov's intrusive list).
+// producers only swap the head pointer and link the previous node, so push never blocks; the consumer
+// owns the tail. a push that has swapped the head but not linked its node yet is briefly invisible,
+// which only delays it to the next pop.
+template <typename T>
+class MpscQueue {
+public:
+	MpscQueue() : head{ new Node{} }, tail{ head.load(std::memory_order_relaxed) } {}
+
+	~MpscQueue() {
+		T value{};
+		while (pop(value)) {}
+		delete tail;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// safe from any thread
+	void push(T value) {
+		Node* node = new Node{ std::move(value) };
+		Node* previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	// consumer thread only; false if nothing is ready
+	bool pop(T& value) {
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (next == nullptr) return false;
+		value = std::move(next->value);
+		delete tail;
+		tail = next; // next becomes the new stub; its value has been moved out
+		return true;
+	}
+private:
+	struct Node {
+		T value{};
+		std::atomic<Node*> next{ nullptr };
+	};
+
+	std::atomic<Node*> head; // last pushed node
+	Node* tail;              // stub before the oldest unconsumed node
+};
@@ -0,0 +1,279 @@
+#include "OsmReader.h"
+
+#include "MappedFile.h"
+
+// std
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <string>
+
+namespace {
+    // cursor over the mapped bytes. every scan is bounded by end, the file is not null-terminated.
+    class Scanner {
+    public:
+        Scanner(const char* begin, const char* end) : p{ begin }, end{ end } {}
+
+        bool done() const { return p >= end; }
+
+        // moves to just after the next occurrence of c; returns false at end of file
+        bool skipPast(char c) {
+            const void* found = std::memchr(p, c, static_cast<size_t>(end - p));
+            if (found == nullptr) {
+                p = end;
+                return false;
+            }
+            p = static_cast<const char*>(found) + 1;
+            return true;
+        }
+
+        // moves to just after the next occurrence of token
+        bool skipPast(std::string_view token) {
+            while (skipPast(token[0])) {
+                if (static_cast<size_t>(end - p) >= token.size() - 1 && std::memcmp(p, token.data() + 1, token.size() - 1) == 0) {
+                    p += token.size() - 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void skipSpace() {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+        }
+
+        // element or attribute name
+        std::string_view name() {
+            const char* begin = p;
+            while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' && *p != '=' && *p != '>' && *p != '/') p++;
+            return { begin, static_cast<size_t>(p - begin) };
+        }
+
+        bool startsWith(std::string_view prefix) const {
+            return static_cast<size_t>(end - p) >= prefix.size() && std::memcmp(p, prefix.data(), prefix.size()) == 0;
+        }
+
+        // calls attribute(name, value) for every attribute of the start tag the cursor is in, then moves
+        // past the closing '>'. returns true if the element was self-closing ("/>").
+        template <typename Callback>
+        bool attributes(Callback&& attribute) {
+            while (true) {
+                skipSpace();
+                if (p >= end) return true;
+                if (*p == '>') {
+                    p++;
+                    return false;
+                }
+                if (*p == '/') {
+                    skipPast('>');
+                    return true;
+                }
+
+                const std::string_view key = name();
+                skipSpace();
+                if (p >= end || *p != '=') continue;
+                p++;
+                skipSpace();
+                if (p >= end) return true;
+
+                const char quote = *p++;
+                const char* begin = p;
+                if (!skipPast(quote)) return true;
+                attribute(key, std::string_view{ begin, static_cast<size_t>(p - 1 - begin) });
+            }
+        }
+
+        const char* p;
+        const char* end;
+    };
+
+    uint64_t parseId(std::string_view text) {
+        // negative ids mark objects not yet uploaded; keep their bit pattern so they stay distinct
+        int64_t value = 0;
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return static_cast<uint64_t>(value);
+    }
+
+    double parseCoordinate(std::string_view text) {
+        double value = 0.0;
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+
+    void appendUtf8(std::string& out, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    // replaces the five predefined entities and numeric character references in an attribute value.
+    // values without '&' are returned as they are; decoded ones are kept in storage, which must outlive
+    // the returned view. malformed or unknown references are left in place.
+    std::string_view decodeEntities(std::string_view text, std::deque<std::string>& storage) {
+        if (text.find('&') == std::string_view::npos) return text;
+
+        std::string& out = storage.emplace_back();
+        out.reserve(text.size());
+        size_t i = 0;
+        while (i < text.size()) {
+            const size_t amp = text.find('&', i);
+            const size_t semicolon = amp == std::string_view::npos ? amp : text.find(';', amp + 1);
+            if (semicolon == std::string_view::npos) break;
+            out.append(text, i, amp - i);
+
+            const std::string_view entity = text.substr(amp + 1, semicolon - amp - 1);
+            bool decoded = true;
+            if (entity == "amp") out += '&';
+            else if (entity == "lt") out += '<';
+            else if (entity == "gt") out += '>';
+            else if (entity == "quot") out += '"';
+            else if (entity == "apos") out += '\'';
+            else if (entity.size() > 1 && entity[0] == '#') {
+                const bool hex = entity[1] == 'x' || entity[1] == 'X';
+                const char* digits = entity.data() + (hex ? 2 : 1);
+                const char* digitsEnd = entity.data() + entity.size();
+                uint32_t codePoint = 0;
+                const auto result = std::from_chars(digits, digitsEnd, codePoint, hex ? 16 : 10);
+                decoded = digits != digitsEnd && result.ec == std::errc{} && result.ptr == digitsEnd && codePoint != 0 && codePoint <= 0x10FFFF;
+                if (decoded) appendUtf8(out, codePoint);
+            } else {
+                decoded = false;
+            }
+
+            if (!decoded) out.append(text, amp, semicolon + 1 - amp);
+            i = semicolon + 1;
+        }
+        if (i < text.size()) out.append(text, i, text.size() - i);
+        return out;
+    }
+}
+
+bool OsmReader::read(const char* path) {
+    MappedFile file{};
+    if (!file.open(path)) return false;
+
+    Scanner scanner{ file.begin(), file.end() };
+
+    // reused between ways and relations so parsing does not allocate per element
+    std::vector<uint64_t> refs{};
+    std::vector<OsmMember> members{};
+    std::vector<OsmTag> tags{};
+    std::deque<std::string> decoded{}; // entity-decoded text of the current way or relation
+
+    while (scanner.skipPast('<')) {
+        if (scanner.startsWith("!--")) {
+            scanner.skipPast(std::string_view{ "-->" });
+            continue;
+        }
+        if (scanner.startsWith("?") || scanner.startsWith("!")) {
+            scanner.skipPast('>');
+            continue;
+        }
+
+        const std::string_view element = scanner.name();
+
+        if (element == "node") {
+            uint64_t id = 0;
+            double lat = 0.0;
+            double lon = 0.0;
+            const bool selfClosing = scanner.attributes([&](std::string_view key, std::string_view value) {
+                if (key == "id") id = parseId(value);
+                else if (key == "lat") lat = parseCoordinate(value);
+                else if (key == "lon") lon = parseCoordinate(value);
+            });
+            if (!selfClosing)
+                scanner.skipPast(std::string_view{ "</node>" }); // node tags are not needed
+            if (onNode)
+                onNode(id, lat, lon);
+        } else if (element == "way") {
+            uint64_t id = 0;
+            const bool selfClosing = scanner.attributes([&](std::string_view key, std::string_view value) {
+                if (key == "id") id = parseId(value);
+            });
+
+            refs.clear();
+            tags.clear();
+            decoded.clear();
+            while (!selfClosing && scanner.skipPast('<')) {
+                if (scanner.startsWith("/")) {
+                    scanner.skipPast('>'); // </way>
+                    break;
+                }
+                const std::string_view child = scanner.name();
+                if (child == "nd") {
+                    scanner.attributes([&](std::string_view key, std::string_view value) {
+                        if (key == "ref") refs.push_back(parseId(value));
+                    });
+                } else if (child == "tag") {
+                    OsmTag tag{};
+                    scanner.attributes([&](std::string_view key, std::string_view value) {
+                        if (key == "k") tag.key = decodeEntities(value, decoded);
+                        else if (key == "v") tag.value = decodeEntities(value, decoded);
+                    });
+                    tags.push_back(tag);
+                } else {
+                    scanner.attributes([](std::string_view, std::string_view) {});
+                }
+            }
+            if (onWay)
+                onWay(id, refs, tags);
+        } else if (element == "relation") {
+            uint64_t id = 0;
+            const bool selfClosing = scanner.attributes([&](std::string_view key, std::string_view value) {
+                if (key == "id") id = parseId(value);
+            });
+            if (!onRelation) {
+                if (!selfClosing)
+                    scanner.skipPast(std::string_view{ "</relation>" });
+                continue;
+            }
+
+            members.clear();
+            tags.clear();
+            decoded.clear();
+            while (!selfClosing && scanner.skipPast('<')) {
+                if (scanner.startsWith("/")) {
+                    scanner.skipPast('>'); // </relation>
+                    break;
+                }
+                const std::string_view child = scanner.name();
+                if (child == "member") {
+                    OsmMember member{};
+                    scanner.attributes([&](std::string_view key, std::string_view value) {
+                        if (key == "type") member.type = decodeEntities(value, decoded);
+                        else if (key == "ref") member.ref = parseId(value);
+                        else if (key == "role") member.role = decodeEntities(value, decoded);
+                    });
+                    members.push_back(member);
+                } else if (child == "tag") {
+                    OsmTag tag{};
+                    scanner.attributes([&](std::string_view key, std::string_view value) {
+                        if (key == "k") tag.key = decodeEntities(value, decoded);
+                        else if (key == "v") tag.value = decodeEntities(value, decoded);
+                    });
+                    tags.push_back(tag);
+                } else {
+                    scanner.attributes([](std::string_view, std::string_view) {});
+                }
+            }
+            onRelation(id, members, tags);
+        } else {
+            // <osm>, <bounds>, closing tags and anything else
+            scanner.attributes([](std::string_view, std::string_view) {});
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// key/value pair of an OSM <tag>, with entities such as &amp; decoded. both views point into the mapped
+// file, or into the reader's own buffer when the text had to be decoded, and are only valid during the callback.
+struct OsmTag {
+	std::string_view key;
+	std::string_view value;
+};
+
+// member of an OSM <relation>; type and role are decoded and stay valid like the views of OsmTag
+struct OsmMember {
+	std::string_view type; // "node", "way" or "relation"
+	uint64_t ref;
+	std::string_view role;
+};
+
+// streaming reader for OSM XML files.
+// the file is memory mapped and scanned once front to back; nodes and ways are handed to the callbacks
+// as soon as they are parsed, so no document tree is ever built and memory use stays flat regardless
+// of file size. elements other than nodes, ways and relations are skipped.
+class OsmReader {
+public:
+	std::function<void(uint64_t id, double lat, double lon)> onNode{};
+	std::function<void(uint64_t id, const std::vector<uint64_t>& refs, const std::vector<OsmTag>& tags)> onWay{};
+	std::function<void(uint64_t id, const std::vector<OsmMember>& members, const std::vector<OsmTag>& tags)> onRelation{};
+
+	// returns false if the file cannot be opened
+	bool read(const char* path);
+};
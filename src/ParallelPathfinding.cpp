@@ -0,0 +1,310 @@
+#include "pathfinding.h"
+
+#include "SearchHelpers.h"
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace {
+    constexpr size_t EDGE_GRAIN = 1 << 14;  // edges per task in edge-parallel sweeps
+    constexpr size_t NODE_GRAIN = 1 << 10;  // nodes per task in node-parallel passes
+    constexpr size_t FRONTIER_GRAIN = 64;   // frontier nodes per task in delta-stepping
+    constexpr size_t RELAX_BATCH = 64;      // candidates computed per batch before any compare-and-swap
+
+    using pathfinding::currentTimestamp;
+    using pathfinding::currentNanoseconds;
+
+    // tentative distances shared between threads. non-negative doubles order the same way as their
+    // bit patterns, so atomic-min is an integer compare-and-swap loop.
+    class AtomicDistances {
+    public:
+        AtomicDistances(size_t count) : values{ new std::atomic<uint64_t>[count] }, count{ count } {
+            const uint64_t infinite = toBits(DBL_MAX);
+            for (size_t i = 0; i < count; i++)
+                values[i].store(infinite, std::memory_order_relaxed);
+        }
+
+        double load(size_t index) const { return fromBits(values[index].load(std::memory_order_relaxed)); }
+        void store(size_t index, double distance) { values[index].store(toBits(distance), std::memory_order_relaxed); }
+
+        // lowers the distance to candidate if it is smaller; returns whether it did
+        bool relaxMin(size_t index, double candidate) {
+            const uint64_t bits = toBits(candidate);
+            uint64_t current = values[index].load(std::memory_order_relaxed);
+            while (bits < current) {
+                if (values[index].compare_exchange_weak(current, bits, std::memory_order_relaxed))
+                    return true;
+            }
+            return false;
+        }
+
+        std::vector<double> toVector() const {
+            std::vector<double> result(count);
+            for (size_t i = 0; i < count; i++)
+                result[i] = load(i);
+            return result;
+        }
+    private:
+        static uint64_t toBits(double value) {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        static double fromBits(uint64_t bits) {
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        std::unique_ptr<std::atomic<uint64_t>[]> values;
+        size_t count;
+    };
+
+    // at the fixpoint every reached node has an incoming edge whose relaxation produced its exact
+    // distance; picking it per node over the reverse adjacency needs no synchronization
+    std::vector<uint32_t> derivePredecessors(MapGraph& graph, const std::vector<double>& distance, uint32_t source, ThreadPool& pool) {
+        std::vector<uint32_t> predecessor(graph.nodeCount(), UINT32_MAX);
+        pool.parallelFor(0, graph.nodeCount(), NODE_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++) {
+                if (v == source || distance[v] == DBL_MAX) continue;
+                for (uint32_t slot = graph.reverseOffsets[v]; slot < graph.reverseOffsets[v + 1]; slot++) {
+                    const uint32_t edgeId = graph.reverseEdges[slot];
+                    const double from = distance[graph.reverseSources[slot]];
+                    if (from != DBL_MAX && from + graph.weights[edgeId] == distance[v]) {
+                        predecessor[v] = edgeId;
+                        break;
+                    }
+                }
+            }
+        });
+        return predecessor;
+    }
+
+    // walks the predecessor tree back from "to"; gives up on cycles, which zero-length edges can form
+    std::vector<Edge*> pathTo(MapGraph& graph, const ShortestPathTree& tree, Node* from, Node* to) {
+        std::vector<Edge*> path;
+        if (tree.predecessor[to->id] == UINT32_MAX) return path;
+
+        for (Node* current = to; current != from; current = graph.edges[tree.predecessor[current->id]]->from) {
+            if (tree.predecessor[current->id] == UINT32_MAX || path.size() > graph.nodeCount()) return {};
+            path.push_back(graph.edges[tree.predecessor[current->id]]);
+        }
+
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+}
+
+ShortestPathTree pathfinding::parallelBellmanfordTree(MapGraph& graph, uint32_t source, ThreadPool& pool, const SearchControl* control,
+    std::vector<Edge*>* relaxed) {
+    const uint32_t* sources = graph.sources.data();
+    const uint32_t* targets = graph.targets.data();
+    const double* weights = graph.weights.data();
+
+    const long long beginNanoseconds = currentNanoseconds();
+    AtomicDistances distance{ graph.nodeCount() };
+    distance.store(source, 0.0);
+
+    // edge-parallel rounds over the flat edge arrays. candidates are computed a batch at a time in a
+    // branch-free loop, and only the ones that improve on the current distance pay for a CAS.
+    // relaxations made earlier in a round are visible later in the same round, which only speeds up convergence.
+    size_t rounds = 0;
+    std::vector<bool> reached(relaxed ? graph.nodeCount() : 0, false);
+    std::vector<uint32_t> newlyReached{};
+    std::mutex newlyReachedMutex{};
+    if (relaxed)
+        newlyReached.push_back(source);
+    for (size_t round = 0; round + 1 < graph.nodeCount(); round++) {
+        rounds++;
+        std::atomic<bool> updated{ false };
+        pool.parallelFor(0, graph.edgeCount(), EDGE_GRAIN, [&](size_t begin, size_t end) {
+            double candidates[RELAX_BATCH];
+            bool localUpdated = false;
+            std::vector<uint32_t> localReached{};
+            for (size_t base = begin; base < end; base += RELAX_BATCH) {
+                const size_t count = std::min(RELAX_BATCH, end - base);
+                for (size_t k = 0; k < count; k++)
+                    candidates[k] = distance.load(sources[base + k]) + weights[base + k];
+                for (size_t k = 0; k < count; k++) {
+                    if (candidates[k] < distance.load(targets[base + k]) && distance.relaxMin(targets[base + k], candidates[k])) {
+                        localUpdated = true;
+                        // "reached" is only written between rounds
+                        if (relaxed && !reached[targets[base + k]])
+                            localReached.push_back(targets[base + k]);
+                    }
+                }
+            }
+            if (localUpdated)
+                updated.store(true, std::memory_order_relaxed);
+            if (!localReached.empty()) {
+                std::lock_guard<std::mutex> lock{ newlyReachedMutex };
+                newlyReached.insert(newlyReached.end(), localReached.begin(), localReached.end());
+            }
+        });
+        if (!updated) break;
+
+        // the edges out of the nodes first reached this round, collected by the relax batches above
+        if (relaxed) {
+            for (uint32_t v : newlyReached) {
+                if (reached[v]) continue;
+                reached[v] = true;
+                for (uint32_t slot = graph.offsets[v]; slot < graph.offsets[v + 1]; slot++)
+                    relaxed->push_back(graph.edges[slot]);
+            }
+            newlyReached.clear();
+        }
+        if (control && control->checkpoint(relaxed)) break;
+    }
+
+    ShortestPathTree tree{ distance.toVector(), {} };
+    if (!control || !control->isCancelled())
+        tree.predecessor = derivePredecessors(graph, tree.distance, source, pool);
+    tree.stats.settledNodes = rounds * graph.nodeCount();
+    tree.stats.relaxedEdges = rounds * graph.edgeCount();
+    tree.stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+    return tree;
+}
+
+ShortestPathTree pathfinding::deltaSteppingTree(MapGraph& graph, uint32_t source, ThreadPool& pool, double delta, const SearchControl* control,
+    std::vector<Edge*>* relaxed) {
+    const uint32_t* offsets = graph.offsets.data();
+    const uint32_t* targets = graph.targets.data();
+    const double* weights = graph.weights.data();
+
+    const long long beginNanoseconds = currentNanoseconds();
+    std::atomic<size_t> scannedNodes{ 0 };
+    std::atomic<size_t> relaxedEdges{ 0 };
+
+    // the mean edge weight keeps buckets small while leaving most edges light
+    if (delta <= 0.0) {
+        double total = 0.0;
+        for (size_t slot = 0; slot < graph.edgeCount(); slot++)
+            total += weights[slot];
+        delta = graph.edgeCount() > 0 && total > 0.0 ? total / graph.edgeCount() : 1.0;
+    }
+
+    AtomicDistances distance{ graph.nodeCount() };
+    distance.store(source, 0.0);
+
+    std::vector<std::vector<uint32_t>> buckets(1);
+    buckets[0].push_back(source);
+
+    auto bucketOf = [delta](double dist) { return static_cast<size_t>(dist / delta); };
+
+    // relaxes the light or heavy edges of "nodes" in parallel and files improved nodes into their buckets
+    auto relax = [&](const std::vector<uint32_t>& nodes, bool light) {
+        std::mutex improvedMutex{};
+        std::vector<uint32_t> improved{};
+        pool.parallelFor(0, nodes.size(), FRONTIER_GRAIN, [&](size_t begin, size_t end) {
+            std::vector<uint32_t> localImproved{};
+            size_t localRelaxed = 0;
+            for (size_t i = begin; i < end; i++) {
+                const uint32_t u = nodes[i];
+                const double distU = distance.load(u);
+                for (uint32_t slot = offsets[u]; slot < offsets[u + 1]; slot++) {
+                    if ((weights[slot] <= delta) != light) continue;
+                    localRelaxed++;
+                    if (distance.relaxMin(targets[slot], distU + weights[slot]))
+                        localImproved.push_back(targets[slot]);
+                }
+            }
+            scannedNodes.fetch_add(end - begin, std::memory_order_relaxed);
+            relaxedEdges.fetch_add(localRelaxed, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock{ improvedMutex };
+            improved.insert(improved.end(), localImproved.begin(), localImproved.end());
+        });
+
+        for (uint32_t v : improved) {
+            const size_t index = bucketOf(distance.load(v));
+            if (index >= buckets.size())
+                buckets.resize(index + 1);
+            buckets[index].push_back(v);
+        }
+    };
+
+    std::vector<uint32_t> frontierStamp(graph.nodeCount(), UINT32_MAX);
+    std::vector<uint32_t> settledStamp(graph.nodeCount(), UINT32_MAX);
+    uint32_t phase = 0;
+
+    for (size_t i = 0; i < buckets.size(); i++) {
+        std::vector<uint32_t> settled{};
+
+        // light edges can refill the current bucket, so keep draining it
+        while (!buckets[i].empty()) {
+            std::vector<uint32_t> frontier{};
+            frontier.swap(buckets[i]);
+
+            // skip duplicates and stale entries of nodes that have since improved into an earlier bucket
+            size_t kept = 0;
+            for (uint32_t v : frontier) {
+                if (frontierStamp[v] == phase || bucketOf(distance.load(v)) != i) continue;
+                frontierStamp[v] = phase;
+                frontier[kept++] = v;
+                if (settledStamp[v] != i) {
+                    settledStamp[v] = static_cast<uint32_t>(i);
+                    settled.push_back(v);
+                }
+            }
+            frontier.resize(kept);
+            phase++;
+
+            relax(frontier, true);
+        }
+
+        // heavy edges always leave the bucket, so one pass over everything settled here suffices
+        relax(settled, false);
+
+        // the bucket's nodes are final and all their edges relaxed; they are reported in the order they
+        // were settled, which depends on the threads but stays within the bucket's distance range
+        if (relaxed) {
+            for (uint32_t v : settled) {
+                for (uint32_t slot = offsets[v]; slot < offsets[v + 1]; slot++)
+                    relaxed->push_back(graph.edges[slot]);
+            }
+        }
+        if (control && control->checkpoint(relaxed)) break;
+    }
+
+    ShortestPathTree tree{ distance.toVector(), {} };
+    if (!control || !control->isCancelled())
+        tree.predecessor = derivePredecessors(graph, tree.distance, source, pool);
+    tree.stats.settledNodes = scannedNodes.load();
+    tree.stats.relaxedEdges = relaxedEdges.load();
+    tree.stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+    return tree;
+}
+
+PathfindingSolution pathfinding::parallelBellmanford(MapGraph& graph, Node* from, Node* to, ThreadPool& pool, const PathfindingOptions& options) {
+    const auto beginTimestamp = currentTimestamp();
+    std::vector<Edge*> relaxed{};
+    const ShortestPathTree tree = parallelBellmanfordTree(graph, static_cast<uint32_t>(from->id), pool, options.control,
+        options.recordChecked && options.control ? &relaxed : nullptr);
+    if (options.control && options.control->isCancelled())
+        return { {}, {}, beginTimestamp, currentTimestamp(), tree.stats, true };
+    std::vector<Edge*> path = pathTo(graph, tree, from, to);
+    const auto endTimestamp = currentTimestamp();
+
+    // every round sweeps every edge
+    if (!options.recordChecked)
+        return { {}, path, beginTimestamp, endTimestamp, tree.stats };
+    return { graph.edges, path, beginTimestamp, endTimestamp, tree.stats };
+}
+
+PathfindingSolution pathfinding::deltaStepping(MapGraph& graph, Node* from, Node* to, ThreadPool& pool, double delta, const PathfindingOptions& options) {
+    const auto beginTimestamp = currentTimestamp();
+    std::vector<Edge*> checked{};
+    const ShortestPathTree tree = deltaSteppingTree(graph, static_cast<uint32_t>(from->id), pool, delta, options.control,
+        options.recordChecked ? &checked : nullptr);
+    if (options.control && options.control->isCancelled())
+        return { {}, {}, beginTimestamp, currentTimestamp(), tree.stats, true };
+    std::vector<Edge*> path = pathTo(graph, tree, from, to);
+    const auto endTimestamp = currentTimestamp();
+    return { checked, path, beginTimestamp, endTimestamp, tree.stats };
+}
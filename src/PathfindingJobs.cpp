@@ -0,0 +1,86 @@
+#include "PathfindingJobs.h"
+
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+
+namespace {
+    constexpr float CHECKED_WIDTH = 0.002f;
+    constexpr float PATH_WIDTH = 0.0025f;
+    const glm::vec3 PATH_COLOR{ 1.f, 1.f, 1.f };
+
+    // alternative routes go into the path model after the route itself, which is drawn first and so stays on
+    // top where they overlap
+    constexpr float ALTERNATIVE_WIDTH = 0.0018f;
+    const glm::vec3 ALTERNATIVE_COLOR{ 0.45f, 0.45f, 0.45f };
+
+    // isochrone outlines share the path model too
+    constexpr float BOUNDARY_WIDTH = 0.0015f;
+    const glm::vec3 BOUNDARY_COLOR{ 0.9f, 0.25f, 0.2f };
+
+    // partial results are published once the checked edges have doubled since the last one, so
+    // rebuilding and uploading the growing prefix stays linear in the final size overall
+    constexpr size_t FIRST_PROGRESS_EDGES = 4096;
+}
+
+PathfindingJobs::PathfindingJobs(ThreadPool& pool) : pool{ pool } {}
+
+PathfindingJobs::~PathfindingJobs() {
+    std::unique_lock<std::mutex> lock{ runningMutex };
+    for (const Handle& query : running)
+        query->control.cancel();
+    runningCondition.wait(lock, [&] { return running.empty(); });
+}
+
+PathfindingJobs::Handle PathfindingJobs::submit(std::function<PathfindingSolution(SearchControl& control)> query, glm::vec3 checkedColor) {
+    Handle handle = std::make_shared<Query>();
+    handle->id = nextId++;
+    {
+        std::lock_guard<std::mutex> lock{ runningMutex };
+        running.push_back(handle);
+    }
+
+    pool.submit([this, handle, query = std::move(query), checkedColor] {
+        size_t published = 0;
+        handle->control.onProgress = [&](const std::vector<Edge*>& checked) {
+            if (checked.size() < std::max(FIRST_PROGRESS_EDGES, 2 * published) || handle->control.isCancelled()) return;
+            published = checked.size();
+
+            Result partial{};
+            partial.id = handle->id;
+            partial.partial = true;
+            partial.checked.loadEdges(checked, checkedColor, CHECKED_WIDTH);
+            finished.push(std::move(partial));
+        };
+
+        Result result{};
+        result.id = handle->id;
+        result.solution = query(handle->control);
+        handle->control.onProgress = nullptr;
+        if (!result.solution.cancelled && !handle->control.isCancelled()) {
+            result.checked.loadEdges(result.solution.checked, checkedColor, CHECKED_WIDTH);
+            result.path.loadEdges(result.solution.path, PATH_COLOR, PATH_WIDTH);
+            for (const std::vector<Edge*>& alternative : result.solution.alternatives)
+                result.path.loadEdges(alternative, ALTERNATIVE_COLOR, ALTERNATIVE_WIDTH);
+            for (const std::vector<glm::vec2>& boundary : result.solution.boundaries)
+                result.path.loadOutline(boundary, BOUNDARY_COLOR, BOUNDARY_WIDTH);
+            finished.push(std::move(result));
+        }
+
+        // notify under the lock; the destructor may run as soon as the last job is removed
+        std::lock_guard<std::mutex> lock{ runningMutex };
+        running.erase(std::find(running.begin(), running.end(), handle));
+        runningCondition.notify_all();
+    });
+    return handle;
+}
+
+bool PathfindingJobs::poll(Result& result) {
+    return finished.pop(result);
+}
+
+bool PathfindingJobs::idle() {
+    std::lock_guard<std::mutex> lock{ runningMutex };
+    return running.empty();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Model.h"
+#include "MpscQueue.h"
+#include "pathfinding.h"
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ThreadPool;
+
+// runs pathfinding queries on a thread pool so the frame loop never waits on a search. every job also
+// builds the vertex data for its checked edges and path on the worker, leaving only the GPU upload to
+// the main thread. finished jobs come back through a lock-free queue that the main thread polls.
+// while a search runs it streams partial results with the edges checked so far, so the traversal
+// animation can start before the query completes.
+class PathfindingJobs {
+public:
+	// shared between the submitter and the running job
+	struct Query {
+		uint64_t id = 0;
+		SearchControl control{};
+	};
+	using Handle = std::shared_ptr<Query>;
+
+	struct Result {
+		uint64_t id = 0;
+		bool partial = false;          // only checked is filled, with every edge checked so far
+		PathfindingSolution solution{}; // final results only
+		Model::Data checked{};
+		Model::Data path{};            // the path, then any alternatives and outlines
+	};
+
+	explicit PathfindingJobs(ThreadPool& pool);
+	~PathfindingJobs(); // cancels and waits for running jobs; they still reference whatever their queries captured
+
+	PathfindingJobs(const PathfindingJobs&) = delete;
+	PathfindingJobs& operator=(const PathfindingJobs&) = delete;
+
+	// queues a query, which must pass the given control on to the search through PathfindingOptions::control.
+	// cancelling the handle's control stops the search at its next checkpoint and drops its result
+	Handle submit(std::function<PathfindingSolution(SearchControl& control)> query, glm::vec3 checkedColor);
+
+	// takes one result, in completion order; main thread only
+	bool poll(Result& result);
+
+	// true when no job is running, including cancelled ones that have not stopped yet. only the main thread
+	// submits, so the graph can be changed safely while this holds
+	bool idle();
+private:
+	ThreadPool& pool;
+	MpscQueue<Result> finished{};
+	uint64_t nextId = 1;
+
+	std::mutex runningMutex;
+	std::condition_variable runningCondition;
+	std::vector<Handle> running{};
+};
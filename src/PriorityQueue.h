@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// min-priority queues over node indices used by the label-setting searches in pathfinding.
+// every queue exposes the same interface so searches can be templated on the backend:
+//   reset(nodeCount)  prepare for a new query on a graph of nodeCount nodes
+//   push(node, key)   insert node, or lower its key if the queue supports decrease-key
+//   top()             return the entry with the smallest key without removing it
+//   pop()             remove and return the entry with the smallest key
+//   empty()
+// queues without decrease-key (lazy deletion) may return stale entries; callers skip entries of
+// nodes already settled.
+namespace pathfinding {
+	enum class QueueType {
+		BinaryHeap,     // lazy-deletion binary heap
+		QuaternaryHeap, // 4-ary indexed heap with decrease-key
+		RadixHeap       // monotone radix heap; requires non-negative weights
+	};
+
+	struct QueueEntry {
+		double key;
+		uint32_t node;
+	};
+
+	class BinaryHeap {
+	public:
+		void reset(size_t /*nodeCount*/) { heap.clear(); }
+		bool empty() const { return heap.empty(); }
+
+		void push(uint32_t node, double key) {
+			heap.push_back({ key, node });
+			std::push_heap(heap.begin(), heap.end(), greater);
+		}
+
+		QueueEntry top() const { return heap.front(); }
+
+		QueueEntry pop() {
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			QueueEntry top = heap.back();
+			heap.pop_back();
+			return top;
+		}
+	private:
+		static bool greater(const QueueEntry& a, const QueueEntry& b) { return a.key > b.key; }
+
+		std::vector<QueueEntry> heap{};
+	};
+
+	template <unsigned D>
+	class IndexedHeap {
+	public:
+		void reset(size_t nodeCount) {
+			for (const QueueEntry& entry : heap)
+				position[entry.node] = NOT_IN_HEAP;
+			heap.clear();
+			if (position.size() != nodeCount)
+				position.assign(nodeCount, NOT_IN_HEAP);
+		}
+
+		bool empty() const { return heap.empty(); }
+
+		void push(uint32_t node, double key) {
+			uint32_t index = position[node];
+			if (index == NOT_IN_HEAP) {
+				index = static_cast<uint32_t>(heap.size());
+				heap.push_back({ key, node });
+			} else {
+				assert(key <= heap[index].key && "IndexedHeap only supports decreasing keys");
+				heap[index].key = key;
+			}
+			siftUp(index);
+		}
+
+		QueueEntry top() const { return heap.front(); }
+
+		QueueEntry pop() {
+			QueueEntry top = heap.front();
+			position[top.node] = NOT_IN_HEAP;
+			if (heap.size() > 1) {
+				heap.front() = heap.back();
+				heap.pop_back();
+				siftDown(0);
+			} else {
+				heap.pop_back();
+			}
+			return top;
+		}
+	private:
+		static constexpr uint32_t NOT_IN_HEAP = UINT32_MAX;
+
+		void siftUp(uint32_t index) {
+			const QueueEntry entry = heap[index];
+			while (index > 0) {
+				const uint32_t parent = (index - 1) / D;
+				if (heap[parent].key <= entry.key) break;
+				heap[index] = heap[parent];
+				position[heap[index].node] = index;
+				index = parent;
+			}
+			heap[index] = entry;
+			position[entry.node] = index;
+		}
+
+		void siftDown(uint32_t index) {
+			const QueueEntry entry = heap[index];
+			const uint32_t size = static_cast<uint32_t>(heap.size());
+			while (true) {
+				const uint32_t first = index * D + 1;
+				if (first >= size) break;
+				const uint32_t last = std::min(first + D, size);
+				uint32_t best = first;
+				for (uint32_t child = first + 1; child < last; child++) {
+					if (heap[child].key < heap[best].key)
+						best = child;
+				}
+				if (entry.key <= heap[best].key) break;
+				heap[index] = heap[best];
+				position[heap[index].node] = index;
+				index = best;
+			}
+			heap[index] = entry;
+			position[entry.node] = index;
+		}
+
+		std::vector<QueueEntry> heap{};
+		std::vector<uint32_t> position{};
+	};
+
+	using QuaternaryHeap = IndexedHeap<4>;
+
+	// radix heap over the bit patterns of non-negative doubles, which order the same way as the values.
+	// keys pushed must never be smaller than the last popped key, which holds for Dijkstra with
+	// non-negative edge weights.
+	class RadixHeap {
+	public:
+		void reset(size_t /*nodeCount*/) {
+			for (auto& bucket : buckets)
+				bucket.clear();
+			size = 0;
+			last = 0;
+		}
+
+		bool empty() const { return size == 0; }
+
+		void push(uint32_t node, double key) {
+			const uint64_t bits = toBits(key);
+			assert(bits >= last && "RadixHeap keys must be monotone");
+			buckets[bucketIndex(bits)].push_back({ bits, node });
+			size++;
+		}
+
+		QueueEntry top() {
+			refill();
+			const Entry& top = buckets[0].back();
+			return { fromBits(top.bits), top.node };
+		}
+
+		QueueEntry pop() {
+			refill();
+			const Entry top = buckets[0].back();
+			buckets[0].pop_back();
+			size--;
+			return { fromBits(top.bits), top.node };
+		}
+	private:
+		struct Entry {
+			uint64_t bits;
+			uint32_t node;
+		};
+
+		// ensures bucket 0 holds the current minimum
+		void refill() {
+			if (buckets[0].empty()) {
+				size_t i = 1;
+				while (buckets[i].empty()) i++;
+
+				// new minimum becomes the reference point; redistribute its bucket into lower buckets
+				uint64_t minimum = buckets[i].front().bits;
+				for (const Entry& entry : buckets[i])
+					minimum = std::min(minimum, entry.bits);
+				last = minimum;
+				for (const Entry& entry : buckets[i])
+					buckets[bucketIndex(entry.bits)].push_back(entry);
+				buckets[i].clear();
+			}
+		}
+
+		static uint64_t toBits(double key) {
+			uint64_t bits;
+			std::memcpy(&bits, &key, sizeof(bits));
+			return bits;
+		}
+
+		static double fromBits(uint64_t bits) {
+			double key;
+			std::memcpy(&key, &bits, sizeof(key));
+			return key;
+		}
+
+		// bucket 0 holds keys equal to the last popped key; bucket i holds keys whose highest
+		// differing bit from it is bit i - 1
+		size_t bucketIndex(uint64_t bits) const {
+			const uint64_t diff = bits ^ last;
+			if (diff == 0) return 0;
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse64(&index, diff);
+			return index + 1;
+#else
+			return 64 - __builtin_clzll(diff);
+#endif
+		}
+
+		std::vector<Entry> buckets[65]{};
+		size_t size = 0;
+		uint64_t last = 0;
+	};
+}
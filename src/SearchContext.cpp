@@ -0,0 +1,39 @@
+#include "SearchContext.h"
+
+namespace {
+    // contexts returned by finished queries on this thread, ready for reuse
+    thread_local std::vector<std::unique_ptr<SearchContext>> freeContexts{};
+}
+
+void SearchContext::Release::operator()(SearchContext* context) const {
+    freeContexts.emplace_back(context);
+}
+
+SearchContext::Handle SearchContext::acquire(size_t nodeCount, size_t edgeCount) {
+    std::unique_ptr<SearchContext> context{};
+    if (freeContexts.empty()) {
+        context = std::make_unique<SearchContext>();
+    } else {
+        context = std::move(freeContexts.back());
+        freeContexts.pop_back();
+    }
+    context->begin(nodeCount, edgeCount);
+    return Handle{ context.release() };
+}
+
+void SearchContext::begin(size_t nodeCount, size_t edgeCount) {
+    // generations advance in steps of two; generation + 1 marks settled nodes
+    generation += 2;
+    if (nodes.size() != nodeCount || generation == 0) {
+        nodes.assign(nodeCount, { DBL_MAX, UINT32_MAX, 0 });
+        edgeStamps.assign(edgeStamps.size(), 0);
+        generation = 2;
+    }
+    // new entries start at 0, which is never a live generation
+    if (edgeStamps.size() < edgeCount)
+        edgeStamps.resize(edgeCount, 0);
+
+    binaryHeap.reset(nodeCount);
+    quaternaryHeap.reset(nodeCount);
+    radixHeap.reset(nodeCount);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "PriorityQueue.h"
+
+// std
+#include <cfloat>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// reusable per-query search state: tentative distance, predecessor edge and settled flag per node,
+// a visited mark per edge, plus the priority queues. arrays are sized to the graph once; every entry carries the generation of
+// the query that last wrote it, so starting a new query bumps a counter instead of clearing graph-sized
+// arrays, and a query only ever touches the nodes it visits.
+class SearchContext {
+public:
+	struct Release {
+		void operator()(SearchContext* context) const;
+	};
+	using Handle = std::unique_ptr<SearchContext, Release>;
+
+	// borrows a context from the calling thread's pool (creating one if the pool is empty) and starts a
+	// new query on it. concurrent callers each use their own thread's pool; a thread can hold several
+	// contexts at once, e.g. one per direction of a bidirectional search.
+	// edgeCount only needs to be passed by queries that call markEdge.
+	static Handle acquire(size_t nodeCount, size_t edgeCount = 0);
+
+	SearchContext() = default;
+
+	SearchContext(const SearchContext&) = delete;
+	SearchContext& operator=(const SearchContext&) = delete;
+
+	// starts a new query; O(1) unless the graph size changed or the generation counter wrapped
+	void begin(size_t nodeCount, size_t edgeCount = 0);
+
+	double distance(uint32_t node) const { return nodes[node].stamp >= generation ? nodes[node].distance : DBL_MAX; }
+	uint32_t predecessor(uint32_t node) const { return nodes[node].stamp >= generation ? nodes[node].predecessor : UINT32_MAX; }
+	bool settled(uint32_t node) const { return nodes[node].stamp == generation + 1; }
+
+	// sets the label of a node that is not settled yet
+	void update(uint32_t node, double distance, uint32_t predecessor) { nodes[node] = { distance, predecessor, generation }; }
+	void settle(uint32_t node) { nodes[node].stamp = generation + 1; }
+
+	// marks an edge as visited; true only the first time it is marked in this query
+	bool markEdge(uint32_t edge) {
+		if (edgeStamps[edge] == generation) return false;
+		edgeStamps[edge] = generation;
+		return true;
+	}
+	bool edgeMarked(uint32_t edge) const { return edgeStamps[edge] == generation; }
+
+	// queue of the given type, reset for this query
+	template <typename Queue>
+	Queue& queue() {
+		if constexpr (std::is_same_v<Queue, pathfinding::BinaryHeap>) return binaryHeap;
+		else if constexpr (std::is_same_v<Queue, pathfinding::QuaternaryHeap>) return quaternaryHeap;
+		else return radixHeap;
+	}
+private:
+	// one 16 byte record per node so a relaxation touches a single cache line
+	struct NodeState {
+		double distance;
+		uint32_t predecessor;
+		uint32_t stamp; // generation: reached in this query, generation + 1: settled
+	};
+
+	std::vector<NodeState> nodes{};
+	std::vector<uint32_t> edgeStamps{}; // generation that last marked each edge; only grows
+	uint32_t generation = 0;
+
+	pathfinding::BinaryHeap binaryHeap{};
+	pathfinding::QuaternaryHeap quaternaryHeap{};
+	pathfinding::RadixHeap radixHeap{};
+};
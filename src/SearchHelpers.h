@@ -0,0 +1,47 @@
+#pragma once
+
+#include "MapGraph.h"
+
+// std
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// helpers shared by the searches in the translation units that implement them; not part of the
+// pathfinding interface
+namespace pathfinding {
+	// wall-clock milliseconds since the epoch, for PathfindingSolution::beginTimestamp and endTimestamp
+	inline long long currentTimestamp() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	// steady-clock nanoseconds, for SearchStats::nanoseconds
+	inline long long currentNanoseconds() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// node potentials used to direct the label-setting searches. a potential must be consistent
+	// (weight(u, v) - p(u) + p(v) >= 0) so that a node's first settle is final.
+	struct ZeroPotential {
+		double operator()(uint32_t /*node*/) const { return 0.0; }
+	};
+
+	// straight-line distance to a fixed node; consistent because edge weights are euclidean lengths
+	// of the same projected coordinates
+	struct EuclideanPotential {
+		const double* xs;
+		const double* ys;
+		double x;
+		double y;
+
+		EuclideanPotential(const MapGraph& graph, uint32_t node) : xs{ graph.xs.data() }, ys{ graph.ys.data() }, x{ graph.xs[node] }, y{ graph.ys[node] } {}
+
+		double operator()(uint32_t node) const {
+			const double dx = xs[node] - x;
+			const double dy = ys[node] - y;
+			return std::sqrt(dx * dx + dy * dy);
+		}
+	};
+}
@@ -0,0 +1,222 @@
+#include "SpatialIndex.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+
+namespace {
+    // grids larger than this per side only waste memory on empty cells
+    constexpr size_t MAX_CELLS_PER_SIDE = 4096;
+
+    double squaredDistance(double ax, double ay, double bx, double by) {
+        return (ax - bx) * (ax - bx) + (ay - by) * (ay - by);
+    }
+}
+
+SpatialIndex::SpatialIndex(MapGraph& graph, double nodesPerCell) : graph{ graph } {
+    const size_t nodeCount = graph.nodeCount();
+
+    double maxX = 0.0;
+    double maxY = 0.0;
+    if (nodeCount > 0) {
+        minX = maxX = graph.xs[0];
+        minY = maxY = graph.ys[0];
+        for (size_t i = 1; i < nodeCount; i++) {
+            minX = std::min(minX, graph.xs[i]);
+            maxX = std::max(maxX, graph.xs[i]);
+            minY = std::min(minY, graph.ys[i]);
+            maxY = std::max(maxY, graph.ys[i]);
+        }
+    }
+
+    // square cells sized so the grid averages nodesPerCell nodes per cell
+    const double width = std::max(maxX - minX, DBL_EPSILON);
+    const double height = std::max(maxY - minY, DBL_EPSILON);
+    const double cellCount = std::max(1.0, nodeCount / nodesPerCell);
+    cellSize = std::sqrt(width * height / cellCount);
+    cellSize = std::max({ cellSize, width / MAX_CELLS_PER_SIDE, height / MAX_CELLS_PER_SIDE });
+    columns = static_cast<size_t>(width / cellSize) + 1;
+    rows = static_cast<size_t>(height / cellSize) + 1;
+
+    // counting sort of nodes by cell
+    nodeOffsets.assign(columns * rows + 1, 0);
+    for (size_t i = 0; i < nodeCount; i++)
+        nodeOffsets[cellY(graph.ys[i]) * columns + cellX(graph.xs[i]) + 1]++;
+    for (size_t c = 0; c < columns * rows; c++)
+        nodeOffsets[c + 1] += nodeOffsets[c];
+
+    std::vector<uint32_t> cursor(nodeOffsets.begin(), nodeOffsets.end() - 1);
+    cellNodes.resize(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; i++)
+        cellNodes[cursor[cellY(graph.ys[i]) * columns + cellX(graph.xs[i])]++] = i;
+
+    // edges go into every cell their bounding box touches; two passes, count then fill
+    auto forEachEdgeCell = [&](uint32_t edge, auto&& f) {
+        const uint32_t a = graph.sources[edge];
+        const uint32_t b = graph.targets[edge];
+        const size_t x0 = cellX(std::min(graph.xs[a], graph.xs[b]));
+        const size_t x1 = cellX(std::max(graph.xs[a], graph.xs[b]));
+        const size_t y0 = cellY(std::min(graph.ys[a], graph.ys[b]));
+        const size_t y1 = cellY(std::max(graph.ys[a], graph.ys[b]));
+        for (size_t cy = y0; cy <= y1; cy++) {
+            for (size_t cx = x0; cx <= x1; cx++)
+                f(cy * columns + cx);
+        }
+    };
+
+    edgeOffsets.assign(columns * rows + 1, 0);
+    for (uint32_t edge = 0; edge < graph.edgeCount(); edge++)
+        forEachEdgeCell(edge, [&](size_t cell) { edgeOffsets[cell + 1]++; });
+    for (size_t c = 0; c < columns * rows; c++)
+        edgeOffsets[c + 1] += edgeOffsets[c];
+
+    cursor.assign(edgeOffsets.begin(), edgeOffsets.end() - 1);
+    cellEdges.resize(edgeOffsets.back());
+    for (uint32_t edge = 0; edge < graph.edgeCount(); edge++)
+        forEachEdgeCell(edge, [&](size_t cell) { cellEdges[cursor[cell]++] = edge; });
+}
+
+size_t SpatialIndex::cellX(double x) const {
+    const double cell = std::floor((x - minX) / cellSize);
+    return static_cast<size_t>(std::clamp(cell, 0.0, static_cast<double>(columns - 1)));
+}
+
+size_t SpatialIndex::cellY(double y) const {
+    const double cell = std::floor((y - minY) / cellSize);
+    return static_cast<size_t>(std::clamp(cell, 0.0, static_cast<double>(rows - 1)));
+}
+
+template <typename Visit, typename Done>
+void SpatialIndex::searchRings(double x, double y, Visit&& visit, Done&& done) const {
+    const size_t centerX = cellX(x);
+    const size_t centerY = cellY(y);
+
+    for (size_t ring = 0; ; ring++) {
+        // ring covers the border of the square [centerX - ring, centerX + ring] x [centerY - ring, centerY + ring]
+        const bool hasLeft = centerX >= ring;
+        const bool hasRight = centerX + ring < columns;
+        const bool hasTop = centerY >= ring;
+        const bool hasBottom = centerY + ring < rows;
+        const size_t x0 = hasLeft ? centerX - ring : 0;
+        const size_t x1 = hasRight ? centerX + ring : columns - 1;
+        const size_t y0 = hasTop ? centerY - ring : 0;
+        const size_t y1 = hasBottom ? centerY + ring : rows - 1;
+
+        if (hasTop) {
+            for (size_t cx = x0; cx <= x1; cx++)
+                visit(y0 * columns + cx);
+        }
+        if (hasBottom && ring > 0) {
+            for (size_t cx = x0; cx <= x1; cx++)
+                visit(y1 * columns + cx);
+        }
+        for (size_t cy = y0 + (hasTop ? 1 : 0); cy + (hasBottom ? 1 : 0) <= y1; cy++) {
+            if (hasLeft)
+                visit(cy * columns + x0);
+            if (hasRight && ring > 0)
+                visit(cy * columns + x1);
+        }
+
+        // whole grid visited
+        if (!hasLeft && !hasRight && !hasTop && !hasBottom) return;
+
+        // anything unvisited lies beyond one of the sides of the square that still has cells behind it
+        double bound = DBL_MAX;
+        if (x0 > 0) bound = std::min(bound, x - (minX + x0 * cellSize));
+        if (x1 + 1 < columns) bound = std::min(bound, minX + (x1 + 1) * cellSize - x);
+        if (y0 > 0) bound = std::min(bound, y - (minY + y0 * cellSize));
+        if (y1 + 1 < rows) bound = std::min(bound, minY + (y1 + 1) * cellSize - y);
+        if (bound == DBL_MAX || done(std::max(bound, 0.0))) return;
+    }
+}
+
+uint32_t SpatialIndex::nearest(double x, double y) const {
+    uint32_t best = NONE;
+    double bestDist = DBL_MAX;
+    searchRings(x, y, [&](size_t cell) {
+        for (uint32_t i = nodeOffsets[cell]; i < nodeOffsets[cell + 1]; i++) {
+            const uint32_t node = cellNodes[i];
+            const double dist = squaredDistance(x, y, graph.xs[node], graph.ys[node]);
+            if (dist < bestDist) {
+                best = node;
+                bestDist = dist;
+            }
+        }
+    }, [&](double bound) { return best != NONE && bestDist <= bound * bound; });
+    return best;
+}
+
+std::vector<uint32_t> SpatialIndex::kNearest(double x, double y, size_t k) const {
+    // max-heap of the k best so far
+    using Candidate = std::pair<double, uint32_t>;
+    std::priority_queue<Candidate> best{};
+    if (k == 0) return {};
+
+    searchRings(x, y, [&](size_t cell) {
+        for (uint32_t i = nodeOffsets[cell]; i < nodeOffsets[cell + 1]; i++) {
+            const uint32_t node = cellNodes[i];
+            const double dist = squaredDistance(x, y, graph.xs[node], graph.ys[node]);
+            if (best.size() < k) {
+                best.push({ dist, node });
+            } else if (dist < best.top().first) {
+                best.pop();
+                best.push({ dist, node });
+            }
+        }
+    }, [&](double bound) { return best.size() == k && best.top().first <= bound * bound; });
+
+    std::vector<uint32_t> result(best.size());
+    for (size_t i = result.size(); i-- > 0; best.pop())
+        result[i] = best.top().second;
+    return result;
+}
+
+std::vector<uint32_t> SpatialIndex::withinRadius(double x, double y, double radius) const {
+    std::vector<uint32_t> result{};
+    const size_t x0 = cellX(x - radius);
+    const size_t x1 = cellX(x + radius);
+    const size_t y0 = cellY(y - radius);
+    const size_t y1 = cellY(y + radius);
+    for (size_t cy = y0; cy <= y1; cy++) {
+        for (size_t cx = x0; cx <= x1; cx++) {
+            const size_t cell = cy * columns + cx;
+            for (uint32_t i = nodeOffsets[cell]; i < nodeOffsets[cell + 1]; i++) {
+                const uint32_t node = cellNodes[i];
+                if (squaredDistance(x, y, graph.xs[node], graph.ys[node]) <= radius * radius)
+                    result.push_back(node);
+            }
+        }
+    }
+    return result;
+}
+
+SpatialIndex::EdgeSnap SpatialIndex::snapToEdge(double x, double y) const {
+    EdgeSnap best{};
+    double bestDist = DBL_MAX;
+    searchRings(x, y, [&](size_t cell) {
+        for (uint32_t i = edgeOffsets[cell]; i < edgeOffsets[cell + 1]; i++) {
+            const uint32_t edge = cellEdges[i];
+            const double ax = graph.xs[graph.sources[edge]];
+            const double ay = graph.ys[graph.sources[edge]];
+            const double dx = graph.xs[graph.targets[edge]] - ax;
+            const double dy = graph.ys[graph.targets[edge]] - ay;
+
+            // project onto the segment
+            const double lengthSquared = dx * dx + dy * dy;
+            const double t = lengthSquared > 0.0 ? std::clamp(((x - ax) * dx + (y - ay) * dy) / lengthSquared, 0.0, 1.0) : 0.0;
+            const double px = ax + t * dx;
+            const double py = ay + t * dy;
+            const double dist = squaredDistance(x, y, px, py);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = { edge, t, px, py, 0.0 };
+            }
+        }
+    }, [&](double bound) { return best.edge != NONE && bestDist <= bound * bound; });
+
+    if (best.edge != NONE)
+        best.distance = std::sqrt(bestDist);
+    return best;
+}
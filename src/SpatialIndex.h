@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MapGraph.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+// uniform grid over the node coordinates of a MapGraph, built once alongside the graph.
+// nodes and edges are bucketed into square cells stored CSR style (like the graph itself);
+// nearest-neighbour queries scan rings of cells outwards from the query point and stop once no
+// unvisited cell can hold anything closer than the best found so far.
+class SpatialIndex {
+public:
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	// closest point on an edge to a query point
+	struct EdgeSnap {
+		uint32_t edge = NONE;
+		double t = 0.0;        // position along the edge, 0 at "from" and 1 at "to"
+		double x = 0.0;
+		double y = 0.0;
+		double distance = 0.0;
+	};
+
+	// nodesPerCell is the average cell occupancy the grid is sized for
+	SpatialIndex(MapGraph& graph, double nodesPerCell = 2.0);
+
+	SpatialIndex(const SpatialIndex&) = delete;
+	SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+	// closest node, or NONE for an empty graph
+	uint32_t nearest(double x, double y) const;
+
+	// up to k closest nodes, closest first
+	std::vector<uint32_t> kNearest(double x, double y, size_t k) const;
+
+	// all nodes within radius, in no particular order
+	std::vector<uint32_t> withinRadius(double x, double y, double radius) const;
+
+	// closest point on any edge; edge is NONE for a graph without edges
+	EdgeSnap snapToEdge(double x, double y) const;
+private:
+	size_t cellX(double x) const;
+	size_t cellY(double y) const;
+
+	// visits cells in growing square rings around (x, y). visit(cell) is called per cell; after each ring
+	// done(bound) is asked whether to stop, where bound is a lower bound on the distance from (x, y)
+	// to any cell not yet visited
+	template <typename Visit, typename Done>
+	void searchRings(double x, double y, Visit&& visit, Done&& done) const;
+
+	MapGraph& graph;
+
+	double minX = 0.0;
+	double minY = 0.0;
+	double cellSize = 1.0;
+	size_t columns = 1;
+	size_t rows = 1;
+
+	// nodes of cell c occupy [nodeOffsets[c], nodeOffsets[c + 1]) of cellNodes
+	std::vector<uint32_t> nodeOffsets;
+	std::vector<uint32_t> cellNodes;
+
+	// every cell an edge's bounding box overlaps lists the edge
+	std::vector<uint32_t> edgeOffsets;
+	std::vector<uint32_t> cellEdges;
+};
@@ -0,0 +1,141 @@
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+
+namespace {
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local size_t currentIndex = 0;
+}
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < threadCount; i++)
+        queues.push_back(std::make_unique<WorkQueue>());
+    for (size_t i = 0; i < threadCount; i++)
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex };
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+size_t ThreadPool::currentWorker() const {
+    return currentPool == this ? currentIndex : threads.size();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // workers push onto their own deque; outside threads spread tasks round-robin
+    size_t index = currentWorker();
+    if (index == threads.size())
+        index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    {
+        std::lock_guard<std::mutex> lock{ queues[index]->mutex };
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex };
+        queuedTasks++;
+    }
+    sleepCondition.notify_one();
+}
+
+bool ThreadPool::runPendingTask(size_t worker) {
+    std::function<void()> task{};
+
+    // own queue first, newest task (LIFO keeps caches warm)
+    if (worker < queues.size()) {
+        std::lock_guard<std::mutex> lock{ queues[worker]->mutex };
+        if (!queues[worker]->tasks.empty()) {
+            task = std::move(queues[worker]->tasks.back());
+            queues[worker]->tasks.pop_back();
+        }
+    }
+
+    // steal the oldest task of another worker
+    for (size_t i = 1; !task && i <= queues.size(); i++) {
+        const size_t victim = (worker + i) % queues.size();
+        std::lock_guard<std::mutex> lock{ queues[victim]->mutex };
+        if (!queues[victim]->tasks.empty()) {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+        }
+    }
+
+    if (!task) return false;
+
+    queuedTasks--;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+        if (runPendingTask(index)) continue;
+
+        std::unique_lock<std::mutex> lock{ sleepMutex };
+        sleepCondition.wait(lock, [this] { return stopping || queuedTasks > 0; });
+        if (stopping && queuedTasks == 0) return;
+    }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body) {
+    if (end <= begin) return;
+    if (grainSize == 0) grainSize = 1;
+
+    const size_t chunks = (end - begin + grainSize - 1) / grainSize;
+    if (chunks == 1) {
+        body(begin, end);
+        return;
+    }
+
+    // chunks are claimed from a shared counter, by the caller and by helper tasks alike. helpers that run
+    // after every chunk was claimed find nothing left and return without touching body, so the loop state
+    // is shared with them but body and the caller's stack are not
+    struct Loop {
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> finished{ 0 };
+        size_t begin;
+        size_t end;
+        size_t grainSize;
+        size_t chunks;
+        const std::function<void(size_t, size_t)>* body;
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->begin = begin;
+    loop->end = end;
+    loop->grainSize = grainSize;
+    loop->chunks = chunks;
+    loop->body = &body;
+
+    auto runChunks = [](Loop& state) {
+        for (size_t chunk = state.next.fetch_add(1, std::memory_order_relaxed); chunk < state.chunks;
+            chunk = state.next.fetch_add(1, std::memory_order_relaxed)) {
+            const size_t chunkBegin = state.begin + chunk * state.grainSize;
+            (*state.body)(chunkBegin, std::min(chunkBegin + state.grainSize, state.end));
+            state.finished.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    const size_t helpers = std::min(chunks - 1, threads.size());
+    for (size_t i = 0; i < helpers; i++)
+        submit([loop, runChunks] { runChunks(*loop); });
+
+    // work through the chunks of this loop only, then wait for those still running elsewhere. running
+    // unrelated queued tasks here would make the caller wait on whole jobs it has nothing to do with
+    runChunks(*loop);
+    while (loop->finished.load(std::memory_order_acquire) < chunks)
+        std::this_thread::yield();
+}
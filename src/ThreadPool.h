@@ -0,0 +1,54 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work-stealing thread pool. every worker owns a deque; it pops its own newest task first and steals
+// the oldest task of another worker when its deque runs dry. the thread calling parallelFor works
+// through the chunks of its own loop alongside the workers, so nested parallel sections cannot
+// deadlock, and it never runs unrelated tasks while it waits.
+class ThreadPool {
+public:
+	// threadCount == 0 uses one worker per hardware thread
+	explicit ThreadPool(size_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t size() const { return threads.size(); }
+
+	void submit(std::function<void()> task);
+
+	// splits [begin, end) into chunks of at most grainSize and calls body(chunkBegin, chunkEnd) for
+	// each of them across the pool; returns once every chunk has run
+	void parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+
+	// index of the calling worker thread of this pool, or size() for any other thread
+	size_t currentWorker() const;
+private:
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	// runs one queued task, preferring the given worker's own queue; returns false if none was found
+	bool runPendingTask(size_t worker);
+	void workerLoop(size_t index);
+
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::atomic<size_t> queuedTasks{ 0 };
+	std::atomic<size_t> nextQueue{ 0 };
+	bool stopping = false;
+};
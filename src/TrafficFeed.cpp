@@ -0,0 +1,53 @@
+#include "TrafficFeed.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+TrafficFeed::TrafficFeed(const MapGraph& graph) : freeFlow(graph.weights.begin(), graph.weights.end()) {
+    edgesByWay.reserve(graph.edgeCount());
+    for (uint32_t edge = 0; edge < graph.edgeCount(); edge++)
+        edgesByWay.emplace_back(graph.edgeWayIds[edge], edge);
+    std::sort(edgesByWay.begin(), edgesByWay.end());
+}
+
+bool TrafficFeed::next(std::istream& input, std::vector<WeightUpdate>& batch) {
+    batch.clear();
+    bool read = false;
+    std::string line;
+    while (std::getline(input, line)) {
+        std::istringstream fields{ line };
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') continue;
+        read = true;
+        if (kind == "commit") return true;
+
+        uint64_t id = 0;
+        double factor = 0.0;
+        if (!(fields >> id >> factor) || !std::isfinite(factor)) {
+            skipped++;
+            continue;
+        }
+
+        if (kind == "way") {
+            auto first = std::lower_bound(edgesByWay.begin(), edgesByWay.end(), std::make_pair(id, uint32_t{ 0 }));
+            if (first == edgesByWay.end() || first->first != id) {
+                skipped++;
+                continue;
+            }
+            for (auto it = first; it != edgesByWay.end() && it->first == id; ++it)
+                add(it->second, factor, batch);
+        } else if (kind == "edge" && id < freeFlow.size()) {
+            add(static_cast<uint32_t>(id), factor, batch);
+        } else {
+            skipped++;
+        }
+    }
+    return read;
+}
+
+void TrafficFeed::add(uint32_t edge, double factor, std::vector<WeightUpdate>& batch) const {
+    batch.push_back({ edge, freeFlow[edge] * std::max(factor, 1.0) });
+}
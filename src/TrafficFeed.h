@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MapGraph.h"
+
+// std
+#include <cstdint>
+#include <istream>
+#include <utility>
+#include <vector>
+
+// turns a live congestion feed into batches of MapGraph weight updates. the feed is line-based text, so
+// a recorded file replays the same way a socket stream would:
+//   way <osm way id> <factor>   every edge cut from the way at factor times its free-flow weight
+//   edge <edge id> <factor>     a single edge
+//   commit                      ends the batch
+// blank lines and lines starting with '#' are ignored. factors below 1 are raised to 1, so weights never
+// drop below the straight-line lengths the A* potentials assume. TrafficProfiles keeps its own copy of the
+// free-flow weights, so time-dependent searches use the profiles and ignore these updates.
+class TrafficFeed {
+public:
+	// remembers the graph's current weights as free flow; create it before applying any update
+	explicit TrafficFeed(const MapGraph& graph);
+
+	TrafficFeed(const TrafficFeed&) = delete;
+	TrafficFeed& operator=(const TrafficFeed&) = delete;
+
+	// reads up to the next commit (or the end of the stream) into batch; false once nothing is left.
+	// malformed lines and unknown ways or edges are skipped and counted
+	bool next(std::istream& input, std::vector<WeightUpdate>& batch);
+
+	size_t skippedLines() const { return skipped; }
+private:
+	void add(uint32_t edge, double factor, std::vector<WeightUpdate>& batch) const;
+
+	std::vector<double> freeFlow{};
+	std::vector<std::pair<uint64_t, uint32_t>> edgesByWay{}; // (way id, edge), sorted
+	size_t skipped = 0;
+};
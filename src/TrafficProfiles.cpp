@@ -0,0 +1,201 @@
+#include "TrafficProfiles.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    // binary profile file: a ProfileFileHeader followed by the way ids (sorted), the profile index of
+    // each way, the profile offsets and the breakpoints
+    constexpr char PROFILE_FILE_MAGIC[8] = { 'T', 'P', 'V', 'T', 'R', 'A', 'F', 'F' };
+    constexpr uint32_t PROFILE_FILE_VERSION = 1;
+    constexpr uint32_t PROFILE_FILE_BYTE_ORDER = 0x01020304;
+
+    struct ProfileFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t wayCount;
+        uint64_t profileCount;
+        uint64_t breakpointCount;
+    };
+
+    uint64_t hashProfile(const TrafficProfiles::Breakpoint* begin, const TrafficProfiles::Breakpoint* end) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (const TrafficProfiles::Breakpoint* b = begin; b != end; ++b) {
+            uint32_t words[2];
+            std::memcpy(&words[0], &b->time, sizeof(float));
+            std::memcpy(&words[1], &b->pace, sizeof(float));
+            for (uint32_t word : words)
+                hash = (hash ^ word) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    bool validProfile(const TrafficProfiles::Breakpoint* begin, const TrafficProfiles::Breakpoint* end) {
+        if (begin == end) return false;
+        for (const TrafficProfiles::Breakpoint* b = begin; b != end; ++b) {
+            if (!(b->time >= 0.f && b->time < TrafficProfiles::PERIOD && b->pace > 0.f && std::isfinite(b->pace))) return false;
+            if (b != begin && !(b[-1].time < b->time)) return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool readArray(std::ifstream& file, std::vector<T>& array, uint64_t count) {
+        array.resize(count);
+        file.read(reinterpret_cast<char*>(array.data()), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(file);
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& file, const std::vector<T>& array) {
+        file.write(reinterpret_cast<const char*>(array.data()), static_cast<std::streamsize>(array.size() * sizeof(T)));
+    }
+}
+
+void TrafficProfiles::set(uint64_t wayId, const std::vector<Breakpoint>& profile) {
+    if (!validProfile(profile.data(), profile.data() + profile.size()))
+        throw std::runtime_error("invalid traffic profile!");
+    wayProfiles[wayId] = intern(profile);
+}
+
+uint32_t TrafficProfiles::intern(const std::vector<Breakpoint>& profile) {
+    const uint64_t hash = hashProfile(profile.data(), profile.data() + profile.size());
+    auto [first, last] = profilesByHash.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        const uint32_t candidate = it->second;
+        const Breakpoint* begin = breakpoints.data() + profileOffsets[candidate];
+        const size_t size = profileOffsets[candidate + 1] - profileOffsets[candidate];
+        if (size == profile.size() && std::equal(profile.begin(), profile.end(), begin,
+            [](const Breakpoint& a, const Breakpoint& b) { return a.time == b.time && a.pace == b.pace; }))
+            return candidate;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(profileCount());
+    breakpoints.insert(breakpoints.end(), profile.begin(), profile.end());
+    profileOffsets.push_back(static_cast<uint32_t>(breakpoints.size()));
+    profilesByHash.emplace(hash, index);
+    for (const Breakpoint& b : profile)
+        fastestPace = std::min(fastestPace, static_cast<double>(b.pace));
+    return index;
+}
+
+bool TrafficProfiles::load(const char* path) {
+    std::ifstream file{ path, std::ios::binary | std::ios::ate };
+    if (!file) return false;
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    ProfileFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, PROFILE_FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != PROFILE_FILE_VERSION || header.byteOrder != PROFILE_FILE_BYTE_ORDER
+        || header.profileCount >= UINT32_MAX || header.breakpointCount >= UINT32_MAX || header.wayCount >= UINT32_MAX)
+        return false;
+
+    // counts come from the file, so check they add up to its size before allocating anything
+    const uint64_t expected = sizeof(header) + header.wayCount * (sizeof(uint64_t) + sizeof(uint32_t))
+        + (header.profileCount + 1) * sizeof(uint32_t) + header.breakpointCount * sizeof(Breakpoint);
+    if (expected != fileSize) return false;
+
+    std::vector<uint64_t> wayIds{};
+    std::vector<uint32_t> wayIndices{};
+    std::vector<uint32_t> offsets{};
+    std::vector<Breakpoint> points{};
+    if (!readArray(file, wayIds, header.wayCount) || !readArray(file, wayIndices, header.wayCount)
+        || !readArray(file, offsets, header.profileCount + 1) || !readArray(file, points, header.breakpointCount))
+        return false;
+
+    // validate everything before replacing the current profiles
+    if (offsets.front() != 0 || offsets.back() != points.size()) return false;
+    for (size_t i = 0; i < header.profileCount; i++) {
+        if (offsets[i] > offsets[i + 1] || !validProfile(points.data() + offsets[i], points.data() + offsets[i + 1])) return false;
+    }
+    for (uint32_t index : wayIndices) {
+        if (index >= header.profileCount) return false;
+    }
+
+    profileOffsets = std::move(offsets);
+    breakpoints = std::move(points);
+    profilesByHash.clear();
+    fastestPace = FREE_FLOW_PACE;
+    for (uint32_t i = 0; i < profileCount(); i++) {
+        profilesByHash.emplace(hashProfile(breakpoints.data() + profileOffsets[i], breakpoints.data() + profileOffsets[i + 1]), i);
+        for (uint32_t b = profileOffsets[i]; b < profileOffsets[i + 1]; b++)
+            fastestPace = std::min(fastestPace, static_cast<double>(breakpoints[b].pace));
+    }
+    wayProfiles.clear();
+    wayProfiles.reserve(wayIds.size());
+    for (size_t i = 0; i < wayIds.size(); i++)
+        wayProfiles[wayIds[i]] = wayIndices[i];
+    return true;
+}
+
+bool TrafficProfiles::save(const char* path) const {
+    std::vector<std::pair<uint64_t, uint32_t>> ways(wayProfiles.begin(), wayProfiles.end());
+    std::sort(ways.begin(), ways.end());
+    std::vector<uint64_t> wayIds(ways.size());
+    std::vector<uint32_t> wayIndices(ways.size());
+    for (size_t i = 0; i < ways.size(); i++) {
+        wayIds[i] = ways[i].first;
+        wayIndices[i] = ways[i].second;
+    }
+
+    ProfileFileHeader header{};
+    std::memcpy(header.magic, PROFILE_FILE_MAGIC, sizeof(header.magic));
+    header.version = PROFILE_FILE_VERSION;
+    header.byteOrder = PROFILE_FILE_BYTE_ORDER;
+    header.wayCount = ways.size();
+    header.profileCount = profileCount();
+    header.breakpointCount = breakpoints.size();
+
+    std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(file, wayIds);
+    writeArray(file, wayIndices);
+    writeArray(file, profileOffsets);
+    writeArray(file, breakpoints);
+    return static_cast<bool>(file);
+}
+
+void TrafficProfiles::bind(const MapGraph& graph) {
+    lengths.assign(graph.weights.begin(), graph.weights.end());
+    edgeProfiles.assign(graph.edgeCount(), FREE_FLOW);
+    if (wayProfiles.empty()) return;
+    for (size_t edge = 0; edge < graph.edgeCount(); edge++) {
+        auto it = wayProfiles.find(graph.edgeWayIds[edge]);
+        if (it != wayProfiles.end())
+            edgeProfiles[edge] = it->second;
+    }
+}
+
+double TrafficProfiles::pathTravelTime(const std::vector<Edge*>& path, double departure) const {
+    double time = departure;
+    for (const Edge* edge : path)
+        time += travelTime(static_cast<uint32_t>(edge->id), time);
+    return time - departure;
+}
+
+double TrafficProfiles::pace(uint32_t profile, double time) const {
+    const Breakpoint* first = breakpoints.data() + profileOffsets[profile];
+    const Breakpoint* last = breakpoints.data() + profileOffsets[profile + 1];
+    if (last - first == 1) return first->pace;
+
+    time = std::fmod(time, PERIOD);
+    if (time < 0.0) time += PERIOD;
+
+    // segment containing time; before the first or after the last breakpoint it wraps around midnight
+    const Breakpoint* next = std::upper_bound(first, last, time, [](double t, const Breakpoint& b) { return t < b.time; });
+    const Breakpoint& a = next == first ? last[-1] : next[-1];
+    const Breakpoint& b = next == last ? first[0] : next[0];
+    double t0 = a.time;
+    double t1 = b.time;
+    if (next == first) t0 -= PERIOD;
+    if (next == last) t1 += PERIOD;
+    return a.pace + (b.pace - a.pace) * (time - t0) / (t1 - t0);
+}
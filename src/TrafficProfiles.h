@@ -0,0 +1,78 @@
+#pragma once
+
+#include "MapGraph.h"
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// time-dependent travel times keyed by OSM way id. a profile is a piecewise-linear pace function
+// (seconds per kilometre) over one day that repeats daily; the travel time of an edge leaving at time t
+// is its length times the pace of its way's profile at t. profiles are interned into a shared pool, so
+// ways with identical profiles, and every edge of a way, cost one 32 bit index each.
+// searches assume FIFO edges (leaving later never arrives earlier), i.e. the pace never drops faster
+// than one second per second of the day per kilometre of edge length.
+class TrafficProfiles {
+public:
+	static constexpr double PERIOD = 86400.0;          // seconds; profiles repeat daily
+	static constexpr double FREE_FLOW_PACE = 72.0;     // seconds per kilometre (50 km/h) on ways without a profile
+	static constexpr uint32_t FREE_FLOW = UINT32_MAX;  // profile index of ways without a profile
+
+	struct Breakpoint {
+		float time; // seconds since midnight, in [0, PERIOD)
+		float pace; // seconds per kilometre, > 0
+	};
+
+	TrafficProfiles() = default;
+
+	TrafficProfiles(const TrafficProfiles&) = delete;
+	TrafficProfiles& operator=(const TrafficProfiles&) = delete;
+
+	// sets the profile of a way; breakpoints must be sorted by time. a replaced profile stays in the pool
+	void set(uint64_t wayId, const std::vector<Breakpoint>& breakpoints);
+
+	// reads/writes the binary profile file; load returns false (keeping the current profiles) if the
+	// file is missing or malformed
+	bool load(const char* path);
+	bool save(const char* path) const;
+
+	// resolves the profile of every edge through MapGraph::edgeWayIds and copies the current weights as the
+	// free-flow edge lengths; call again after changing profiles. bind before any traffic updates, which
+	// raise the graph's weights in place and would otherwise be counted on top of the profiles
+	void bind(const MapGraph& graph);
+
+	// seconds to traverse a bound edge when leaving at "departure" (seconds since midnight of any day)
+	double travelTime(uint32_t edge, double departure) const {
+		const double length = lengths[edge] * KM_PER_UNIT;
+		const uint32_t profile = edgeProfiles[edge];
+		return length * (profile == FREE_FLOW ? FREE_FLOW_PACE : pace(profile, departure));
+	}
+
+	// travel time of a path of bound edges, following the clock along it
+	double pathTravelTime(const std::vector<Edge*>& path, double departure) const;
+
+	// seconds per graph unit that no edge beats at any time; scales euclidean distance into an A* lower bound
+	double minimumPace() const { return fastestPace * KM_PER_UNIT; }
+
+	size_t profileCount() const { return profileOffsets.size() - 1; }
+	size_t wayCount() const { return wayProfiles.size(); }
+private:
+	// graph coordinates are 1/150 degree; a degree of latitude is about 111.32 km
+	static constexpr double KM_PER_UNIT = 111.32 / 150.0;
+
+	uint32_t intern(const std::vector<Breakpoint>& profile);
+	double pace(uint32_t profile, double time) const;
+
+	// pool; profile i owns breakpoints [profileOffsets[i], profileOffsets[i + 1])
+	std::vector<uint32_t> profileOffsets{ 0 };
+	std::vector<Breakpoint> breakpoints{};
+	std::unordered_multimap<uint64_t, uint32_t> profilesByHash{};
+	double fastestPace = FREE_FLOW_PACE;
+
+	std::unordered_map<uint64_t, uint32_t> wayProfiles{};
+
+	// bound graph; free-flow weights as they were at bind time
+	std::vector<double> lengths{};
+	std::vector<uint32_t> edgeProfiles{};
+};
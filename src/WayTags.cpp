@@ -0,0 +1,133 @@
+#include "WayTags.h"
+
+// std
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    Highway parseHighway(std::string_view value) {
+        static const std::unordered_map<std::string_view, Highway> values{
+            { "motorway", Highway::Motorway },
+            { "trunk", Highway::Trunk },
+            { "primary", Highway::Primary },
+            { "secondary", Highway::Secondary },
+            { "tertiary", Highway::Tertiary },
+            { "unclassified", Highway::Unclassified },
+            { "residential", Highway::Residential },
+            { "motorway_link", Highway::MotorwayLink },
+            { "trunk_link", Highway::TrunkLink },
+            { "primary_link", Highway::PrimaryLink },
+            { "secondary_link", Highway::SecondaryLink },
+            { "tertiary_link", Highway::TertiaryLink },
+            { "living_street", Highway::LivingStreet },
+            { "service", Highway::Service },
+            { "road", Highway::Road },
+        };
+        auto it = values.find(value);
+        return it == values.end() ? Highway::Other : it->second;
+    }
+
+    Oneway parseOneway(std::string_view value) {
+        if (value == "yes" || value == "true" || value == "1") return Oneway::Forward;
+        if (value == "-1" || value == "reverse") return Oneway::Backward;
+        if (value == "reversible" || value == "alternating") return Oneway::Reversible;
+        return Oneway::No;
+    }
+
+    Access parseAccess(std::string_view value) {
+        if (value == "no" || value == "private" || value == "agricultural" || value == "forestry") return Access::No;
+        if (value == "destination" || value == "delivery" || value == "customers") return Access::Destination;
+        return Access::Yes;
+    }
+
+    // "50", "30 mph", "none"; anything else is unknown
+    uint16_t parseMaxspeed(std::string_view value) {
+        unsigned speed = 0;
+        const auto result = std::from_chars(value.data(), value.data() + value.size(), speed);
+        if (result.ec != std::errc{}) return 0;
+
+        std::string_view unit = value.substr(static_cast<size_t>(result.ptr - value.data()));
+        while (!unit.empty() && unit.front() == ' ') unit.remove_prefix(1);
+        if (unit == "mph") speed = speed * 1609 / 1000;
+        else if (!unit.empty() && unit != "km/h" && unit != "kmh") return 0;
+        return static_cast<uint16_t>(speed);
+    }
+}
+
+WayTags WayTags::parse(const std::vector<OsmTag>& tags) {
+    WayTags result{};
+    bool onewayTagged = false;
+    bool roundabout = false;
+    Access motorVehicle = Access::Yes;
+    bool motorVehicleTagged = false;
+
+    for (const OsmTag& tag : tags) {
+        if (tag.key == "highway") {
+            result.highway = parseHighway(tag.value);
+        } else if (tag.key == "oneway") {
+            result.oneway = parseOneway(tag.value);
+            onewayTagged = true;
+        } else if (tag.key == "junction") {
+            roundabout = tag.value == "roundabout" || tag.value == "circular";
+        } else if (tag.key == "access") {
+            result.access = parseAccess(tag.value);
+        } else if (tag.key == "motor_vehicle" || tag.key == "motorcar") {
+            motorVehicle = parseAccess(tag.value);
+            motorVehicleTagged = true;
+        } else if (tag.key == "maxspeed") {
+            result.maxspeed = parseMaxspeed(tag.value);
+        }
+    }
+
+    // the more specific vehicle tag overrides the general one
+    if (motorVehicleTagged)
+        result.access = motorVehicle;
+
+    // implied oneways unless tagged otherwise
+    if (!onewayTagged && (roundabout || result.highway == Highway::Motorway || result.highway == Highway::MotorwayLink))
+        result.oneway = Oneway::Forward;
+
+    return result;
+}
+
+bool WayTags::routable() const {
+    return highway != Highway::None && highway != Highway::Other && access != Access::No && oneway != Oneway::Reversible;
+}
+
+Restriction parseRestriction(const std::vector<OsmTag>& tags) {
+    bool restrictionType = false;
+    Restriction general = Restriction::None;
+    Restriction motorcar = Restriction::None;
+    bool exempt = false;
+
+    const auto kind = [](std::string_view value) {
+        if (value.substr(0, 3) == "no_") return Restriction::No;
+        if (value.substr(0, 5) == "only_") return Restriction::Only;
+        return Restriction::None;
+    };
+    for (const OsmTag& tag : tags) {
+        if (tag.key == "type") {
+            restrictionType = tag.value == "restriction";
+        } else if (tag.key == "restriction") {
+            general = kind(tag.value);
+        } else if (tag.key == "restriction:motorcar") {
+            motorcar = kind(tag.value);
+        } else if (tag.key == "except") {
+            // a semicolon separated list of vehicle types
+            std::string_view list = tag.value;
+            while (!list.empty() && !exempt) {
+                const size_t end = std::min(list.find(';'), list.size());
+                std::string_view item = list.substr(0, end);
+                while (!item.empty() && item.front() == ' ') item.remove_prefix(1);
+                while (!item.empty() && item.back() == ' ') item.remove_suffix(1);
+                exempt = item == "motorcar" || item == "motor_vehicle";
+                list.remove_prefix(std::min(end + 1, list.size()));
+            }
+        }
+    }
+
+    if (!restrictionType || exempt) return Restriction::None;
+    return motorcar != Restriction::None ? motorcar : general;
+}
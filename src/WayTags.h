@@ -0,0 +1,63 @@
+#pragma once
+
+#include "OsmReader.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+// the tags of a way that matter for routing, interned into compact enums once per way while streaming
+enum class Highway : uint8_t {
+	None, // not a highway
+	Motorway,
+	Trunk,
+	Primary,
+	Secondary,
+	Tertiary,
+	Unclassified,
+	Residential,
+	MotorwayLink,
+	TrunkLink,
+	PrimaryLink,
+	SecondaryLink,
+	TertiaryLink,
+	LivingStreet,
+	Service,
+	Road,
+	Other // footways, tracks, construction, ...; not driveable
+};
+
+enum class Oneway : uint8_t {
+	No,
+	Forward,  // oneway=yes, or implied by motorways and roundabouts
+	Backward, // oneway=-1; only drivable against the node order
+	Reversible // direction changes over the day; treated as closed
+};
+
+enum class Access : uint8_t {
+	Yes,
+	Destination,
+	No // access=no/private, or motor_vehicle=no
+};
+
+struct WayTags {
+	Highway highway = Highway::None;
+	Oneway oneway = Oneway::No;
+	Access access = Access::Yes;
+	uint16_t maxspeed = 0; // km/h, 0 if unknown
+
+	static WayTags parse(const std::vector<OsmTag>& tags);
+
+	// whether cars may drive on the way at all
+	bool routable() const;
+};
+
+// kind of a turn restriction relation
+enum class Restriction : uint8_t {
+	None, // not a restriction, or one that does not apply to cars
+	No,   // no_left_turn, no_u_turn, ...: the turn from "from" to "to" is forbidden
+	Only  // only_straight_on, ...: every other turn from "from" is forbidden
+};
+
+// reads type=restriction relations, including restriction:motorcar; except=motorcar exempts cars
+Restriction parseRestriction(const std::vector<OsmTag>& tags);
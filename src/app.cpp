@@ -7,6 +7,17 @@
 
 #include "Texture.h"
 #include "MapGraph.h"
+#include "ContractionHierarchy.h"
+#include "CustomizableRoutePlanning.h"
+#include "DynamicShortestPathTree.h"
+#include "HubLabels.h"
+#include "Isochrones.h"
+#include "Landmarks.h"
+#include "SpatialIndex.h"
+#include "ThreadPool.h"
+#include "PathfindingJobs.h"
+#include "TrafficFeed.h"
+#include "TrafficProfiles.h"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -18,8 +29,11 @@
 #include <array>
 #include <chrono>
 #include <cassert>
+#include <ctime>
+#include <fstream>
 #include <stdexcept>
 #include <iostream>
+#include <mutex>
 #include "pathfinding.h"
 #include <unordered_set>
 
@@ -36,11 +50,45 @@ App::~App() {}
 // input
 bool leftClickPressed = false;
 bool rightClickPressed = false;
+bool trafficUpdatePressed = false;
 double lastX, lastY;
 
 // 0 = Dijkstra's
 // 1 = Bellman-Ford
+// 2 = Bidirectional Dijkstra's
+// 3 = A*
+// 4 = Bidirectional A*
+// 5 = Contraction Hierarchies
+// 6 = Parallel Bellman-Ford
+// 7 = Delta-Stepping
+// 8 = Time-Dependent A*
+// 9 = Customizable Route Planning
+// 10 = ALT
+// 11 = Hub Labels
+// 12 = Alternative Routes
+// 13 = K Shortest Paths
+// 14 = Edge-Based A*
+// 15 = Isochrone
 int pathfindingAlgorithmType = 0;
+const char* pathfindingAlgorithmNames[] = { "Dijkstra's", "Bellman-Ford", "Bidirectional Dijkstra's", "A*", "Bidirectional A*", "Contraction Hierarchies",
+    "Parallel Bellman-Ford", "Delta-Stepping", "Time-Dependent A*", "Customizable Route Planning", "ALT", "Hub Labels",
+    "Alternative Routes", "K Shortest Paths", "Edge-Based A*", "Isochrone" };
+const int pathfindingAlgorithmCount = sizeof(pathfindingAlgorithmNames) / sizeof(pathfindingAlgorithmNames[0]);
+
+// turn penalties of edge-based A*, in edge weights; a typical edge weighs about 0.15
+const TurnCosts TURN_COSTS{ 0.0, 0.07, 0.2, 0.4 };
+
+// local time of day in seconds, the departure time of time-dependent queries
+double secondsSinceMidnight() {
+    const std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    return local.tm_hour * 3600.0 + local.tm_min * 60.0 + local.tm_sec;
+}
 
 // GLFW callback function for mouse button events
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
@@ -56,11 +104,8 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
         if (action == GLFW_PRESS) {
             rightClickPressed = true;
             glfwGetCursorPos(window, &lastX, &lastY);
-            pathfindingAlgorithmType = 1 - pathfindingAlgorithmType;
-            if (pathfindingAlgorithmType == 0)
-                std::cout << "Algorithm set to: Dijkstra's" << std::endl;
-            else
-                std::cout << "Algorithm set to: Bellman-Ford" << std::endl;
+            pathfindingAlgorithmType = (pathfindingAlgorithmType + 1) % pathfindingAlgorithmCount;
+            std::cout << "Algorithm set to: " << pathfindingAlgorithmNames[pathfindingAlgorithmType] << std::endl;
         }
         else if (action == GLFW_RELEASE) {
             rightClickPressed = false;
@@ -68,6 +113,12 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
     }
 }
 
+// GLFW callback function for key events; T replays the next batch of the traffic feed
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_T && action == GLFW_PRESS)
+        trafficUpdatePressed = true;
+}
+
 void App::run() {
     EntityComponentSystem ecs{};
     Entity viewerObject{};
@@ -109,7 +160,25 @@ void App::run() {
     SpatialSystemManager spatialSystemManager{ ecs, device, renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
 
     // graph data structure
-    MapGraph graph{ "files/map.osm" };
+    MapGraph graph{ "files/map.osm", "files/map.graph" }; // binary cache written after the first parse
+    SpatialIndex spatialIndex{ graph }; // nearest node lookups for mouse picking
+    TrafficProfiles trafficProfiles{}; // free-flow everywhere unless a profile file is present
+    if (trafficProfiles.load("files/map.profiles"))
+        std::cout << "Loaded " << trafficProfiles.profileCount() << " traffic profiles for " << trafficProfiles.wayCount() << " ways" << std::endl;
+    trafficProfiles.bind(graph);
+    TrafficFeed trafficFeed{ graph }; // live congestion, replayed from a recorded feed one batch at a time
+    std::ifstream trafficFeedFile{ "files/map.feed" };
+    std::unique_ptr<ContractionHierarchy> contractionHierarchy{}; // built on first use, by whichever job needs it first; dropped when the weights change
+    std::unique_ptr<HubLabels> hubLabels{}; // built on the contraction hierarchy on first use and dropped with it; also guarded by its mutex
+    std::unique_ptr<Isochrones> isochrones{}; // likewise
+    std::mutex contractionHierarchyMutex{};
+    std::shared_ptr<CustomizableRoutePlanning> routePlanning{}; // built on first use; traffic updates only re-customize it, into a new instance
+    std::mutex routePlanningMutex{};
+    DynamicShortestPathTree rerouteTree{ graph }; // tree of the shown query, repaired after each traffic update
+    ThreadPool threadPool{};
+    Landmarks landmarks{ graph, threadPool, "files/map.landmarks" }; // built from the free-flow weights, which traffic only ever raises
+    PathfindingJobs pathfindingJobs{ threadPool }; // declared after everything its jobs reference, so it is destroyed first
+    PathfindingJobs::Handle pendingQuery{}; // query whose results are shown as they arrive
     PathfindingSolution solution{};
     solution.endTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
@@ -143,6 +212,7 @@ void App::run() {
 
     // Set GLFW callbacks
     glfwSetMouseButtonCallback(window.getGLFWwindow(), mouseButtonCallback);
+    glfwSetKeyCallback(window.getGLFWwindow(), keyCallback);
 
     TransformComponent& cameraTransform = ecs.getComponent<TransformComponent>(viewerObject);
 
@@ -199,21 +269,18 @@ void App::run() {
                 worldPoint.z = 0.0;
 
                 // get closest node to mouse position
-                Node* closestNode = graph.nodes.front();
-                double closestDist = glm::distance(glm::vec3(closestNode->x, closestNode->y, 0.0), worldPoint);
-                for (size_t i = 1; i < graph.nodes.size(); i++) {
-                    Node* node = graph.nodes[i];
-                    const double dist = glm::distance(glm::vec3(node->x, node->y, 0.0), worldPoint);
-                    if (dist < closestDist) {
-                        closestNode = node;
-                        closestDist = dist;
-                    }
-                }
+                Node* closestNode = graph.nodes[spatialIndex.nearest(worldPoint.x, worldPoint.y)];
 
                 if ((from == nullptr && to == nullptr) || (from != nullptr && to != nullptr && to != closestNode)) { // select "from"
                     from = closestNode;
                     to = nullptr;
 
+                    // stop a query still running for the old pair
+                    if (pendingQuery) {
+                        pendingQuery->control.cancel();
+                        pendingQuery.reset();
+                    }
+
                     // refresh ECS
                     if (activePathsCreated) {
                         ecs.destroyEntity(activePaths);
@@ -226,16 +293,188 @@ void App::run() {
                 } else if (from != nullptr && to == nullptr && from != closestNode) { // select "to"
                     to = closestNode;
                     
-                    if (pathfindingAlgorithmType == 0) {
-                        solution = pathfinding::dijkstra(graph, from, to);
-                        model = Model::createModelFromEdges(device, solution.checked, glm::vec3(248.f / 2550.f, 201.f / 2550.f, 38.f / 2550.f), 0.002f);
-                    } else {
-                        solution = pathfinding::bellmanford(graph, from, to);
-                        model = Model::createModelFromEdges(device, solution.checked, glm::vec3(38.f / 2550.f, 201.f / 2550.f, 248.f / 2550.f), 0.002f);
+                    // run the query off the render thread; the result is swapped in on a later frame
+                    glm::vec3 checkedColor{};
+                    switch (pathfindingAlgorithmType) {
+                    case 0: checkedColor = glm::vec3(248.f / 2550.f, 201.f / 2550.f, 38.f / 2550.f); break;
+                    case 1: checkedColor = glm::vec3(38.f / 2550.f, 201.f / 2550.f, 248.f / 2550.f); break;
+                    case 2: checkedColor = glm::vec3(248.f / 2550.f, 120.f / 2550.f, 38.f / 2550.f); break;
+                    case 3: checkedColor = glm::vec3(38.f / 2550.f, 248.f / 2550.f, 120.f / 2550.f); break;
+                    case 4: checkedColor = glm::vec3(38.f / 2550.f, 248.f / 2550.f, 201.f / 2550.f); break;
+                    case 5: checkedColor = glm::vec3(201.f / 2550.f, 38.f / 2550.f, 248.f / 2550.f); break;
+                    case 6: checkedColor = glm::vec3(38.f / 2550.f, 120.f / 2550.f, 248.f / 2550.f); break;
+                    case 7: checkedColor = glm::vec3(120.f / 2550.f, 38.f / 2550.f, 248.f / 2550.f); break;
+                    case 8: checkedColor = glm::vec3(248.f / 2550.f, 38.f / 2550.f, 120.f / 2550.f); break;
+                    case 9: checkedColor = glm::vec3(248.f / 2550.f, 38.f / 2550.f, 201.f / 2550.f); break;
+                    case 10: checkedColor = glm::vec3(201.f / 2550.f, 248.f / 2550.f, 38.f / 2550.f); break;
+                    case 11: checkedColor = glm::vec3(120.f / 2550.f, 248.f / 2550.f, 38.f / 2550.f); break;
+                    case 12: checkedColor = glm::vec3(38.f / 2550.f, 201.f / 2550.f, 120.f / 2550.f); break;
+                    case 13: checkedColor = glm::vec3(201.f / 2550.f, 120.f / 2550.f, 38.f / 2550.f); break;
+                    case 14: checkedColor = glm::vec3(120.f / 2550.f, 38.f / 2550.f, 201.f / 2550.f); break;
+                    default: checkedColor = glm::vec3(201.f / 2550.f, 38.f / 2550.f, 38.f / 2550.f); break;
                     }
-                    ubo.indexCount = solution.checked.size() * 6;
 
-                    // create traversal model
+                    const int algorithm = pathfindingAlgorithmType;
+                    pendingQuery = pathfindingJobs.submit([&graph, &contractionHierarchy, &hubLabels, &isochrones, &contractionHierarchyMutex, &routePlanning, &routePlanningMutex, &threadPool, &trafficProfiles, &landmarks, algorithm, from = from, to = to,
+                        departure = secondsSinceMidnight()](SearchControl& control) {
+                        PathfindingOptions options{};
+                        options.stopAtTarget = true;
+                        options.control = &control;
+
+                        // the hierarchy is shared by several algorithms; whichever job needs it first builds it
+                        auto hierarchy = [&]() -> const ContractionHierarchy& {
+                            std::lock_guard<std::mutex> lock{ contractionHierarchyMutex };
+                            if (!contractionHierarchy) {
+                                std::cout << "Building contraction hierarchy..." << std::endl;
+                                contractionHierarchy = std::make_unique<ContractionHierarchy>(graph);
+                                std::cout << "Added " << contractionHierarchy->shortcutCount() << " shortcuts" << std::endl;
+                            }
+                            return *contractionHierarchy;
+                        };
+
+                        switch (algorithm) {
+                        case 0:
+                            return pathfinding::dijkstra(graph, from, to, options);
+                        case 1:
+                            return pathfinding::bellmanford(graph, from, to, options);
+                        case 2:
+                            return pathfinding::bidirectionalDijkstra(graph, from, to, options);
+                        case 3:
+                            return pathfinding::astar(graph, from, to, options);
+                        case 4:
+                            return pathfinding::bidirectionalAstar(graph, from, to, options);
+                        case 5:
+                            return hierarchy().query(from, to, options);
+                        case 6:
+                            return pathfinding::parallelBellmanford(graph, from, to, threadPool, options);
+                        case 7:
+                            return pathfinding::deltaStepping(graph, from, to, threadPool, 0.0, options);
+                        case 8:
+                            return pathfinding::timeDependentAstar(graph, trafficProfiles, from, to, departure, options);
+                        case 9: {
+                            // built or re-customized into a new instance outside the lock and published under it, so
+                            // jobs still querying the current instance are never held up by a customization
+                            std::shared_ptr<CustomizableRoutePlanning> planning{};
+                            {
+                                std::lock_guard<std::mutex> lock{ routePlanningMutex };
+                                planning = routePlanning;
+                            }
+                            if (!planning || !planning->customized()) {
+                                if (!planning) {
+                                    std::cout << "Partitioning graph..." << std::endl;
+                                    planning = std::make_shared<CustomizableRoutePlanning>(graph, threadPool);
+                                } else {
+                                    planning = planning->recustomized();
+                                }
+                                std::cout << "Customized " << planning->cliqueArcCount() << " clique arcs in "
+                                    << planning->customizationNanoseconds() / 1000000 << " ms" << std::endl;
+                                std::lock_guard<std::mutex> lock{ routePlanningMutex };
+                                routePlanning = planning;
+                            }
+                            return planning->query(from, to, options);
+                        }
+                        case 10:
+                            return pathfinding::alt(graph, landmarks, from, to, options);
+                        case 11: {
+                            const ContractionHierarchy& contracted = hierarchy();
+                            const HubLabels* labels = nullptr;
+                            {
+                                std::lock_guard<std::mutex> lock{ contractionHierarchyMutex };
+                                labels = hubLabels.get();
+                            }
+
+                            // built outside the lock and published under it, like the route planning above
+                            if (!labels) {
+                                std::cout << "Building hub labels..." << std::endl;
+                                auto built = std::make_unique<HubLabels>(contracted, threadPool);
+                                std::cout << "Stored " << built->entryCount() << " label entries in "
+                                    << built->memoryBytes() / (1024 * 1024) << " MB" << std::endl;
+                                std::lock_guard<std::mutex> lock{ contractionHierarchyMutex };
+                                if (!hubLabels) hubLabels = std::move(built);
+                                labels = hubLabels.get();
+                            }
+                            return labels->query(from, to, options);
+                        }
+                        case 12:
+                            return pathfinding::alternativeRoutes(graph, from, to, 3, options);
+                        case 13:
+                            return pathfinding::kShortestPaths(graph, from, to, 4, options);
+                        case 14:
+                            return pathfinding::edgeBasedAstar(graph, from, to, TURN_COSTS, options);
+                        default: {
+                            const ContractionHierarchy& contracted = hierarchy();
+                            {
+                                std::lock_guard<std::mutex> lock{ contractionHierarchyMutex };
+                                if (!isochrones)
+                                    isochrones = std::make_unique<Isochrones>(graph, contracted);
+                            }
+
+                            // everything as close to "from" as "to" is: the reached edges are drawn as checked, with
+                            // the outlines around them and the route to "to"
+                            PathfindingSolution route = contracted.query(from, to, options);
+                            if (route.cancelled || route.path.empty()) return route;
+                            double limit = 0.0;
+                            for (const Edge* edge : route.path)
+                                limit += edge->weight;
+                            Isochrone isochrone = isochrones->compute({ static_cast<uint32_t>(from->id) }, limit);
+                            route.checked = std::move(isochrone.edges);
+                            route.boundaries = std::move(isochrone.boundaries);
+                            route.stats = isochrone.stats;
+                            return route;
+                        }
+                        }
+                    }, checkedColor);
+                }
+            }
+
+            // replay the next traffic batch. the graph only changes while no job is searching it, so a
+            // press during a query waits for it to finish
+            if (trafficUpdatePressed && pathfindingJobs.idle()) {
+                trafficUpdatePressed = false;
+                std::vector<WeightUpdate> batch{};
+                if (!trafficFeedFile.is_open() || !trafficFeed.next(trafficFeedFile, batch)) {
+                    std::cout << "No traffic updates left in files/map.feed" << std::endl;
+                } else {
+                    graph.updateWeights(batch);
+                    isochrones.reset();
+                    hubLabels.reset();
+                    contractionHierarchy.reset();
+                    std::cout << "Applied " << batch.size() << " traffic updates" << std::endl;
+
+                    // reroute the shown query by repairing its tree instead of searching again
+                    if (from != nullptr && to != nullptr) {
+                        if (activePathsCreated) {
+                            ecs.destroyEntity(activePaths);
+                            activePathsCreated = false;
+                        }
+                        pendingQuery = pathfindingJobs.submit([&rerouteTree, batch = std::move(batch), from = from, to = to](SearchControl&) {
+                            if (rerouteTree.source() != from) return rerouteTree.build(from, to);
+                            return rerouteTree.repair(batch, to);
+                        }, glm::vec3(248.f / 2550.f, 248.f / 2550.f, 38.f / 2550.f));
+                    }
+                }
+            }
+
+            // swap in results; those of cancelled or superseded queries are dropped
+            PathfindingJobs::Result result{};
+            while (pathfindingJobs.poll(result)) {
+                if (!pendingQuery || result.id != pendingQuery->id) continue;
+
+                // the traversal animation starts with the first result of a query and keeps running
+                // while partial results extend it
+                const long long animationStart = activePathsCreated ? solution.endTimestamp
+                    : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+                if (activePathsCreated) {
+                    ecs.destroyEntity(activePaths);
+                    activePathsCreated = false;
+                }
+
+                if (!result.checked.vertices.empty()) {
+                    // create traversal model; only the upload happens on this thread
+                    model = std::make_shared<Model>(device, result.checked);
+                    ubo.indexCount = static_cast<int>(result.checked.indices.size());
+
                     activePaths = ecs.createEntity();
                     activePathsCreated = true;
                     TransformComponent activePathsTransform{};
@@ -244,22 +483,34 @@ void App::run() {
                     ecs.addComponent<ModelComponent>(activePaths, { model });
                     ecs.addComponent<TransformComponent>(activePaths, activePathsTransform);
                     ecs.addComponent<ActiveComponent>(activePaths, { });
+                }
 
-                    if (solution.path.size() > 0) {
-                        // create optimal path model
-                        model = Model::createModelFromEdges(device, solution.path, glm::vec3(1.f, 1.f, 1.f), 0.0025f);
-                        optimalPath = ecs.createEntity();
-                        optimalPathCreated = true;
-                        TransformComponent optimalPathTransform{};
-                        optimalPathTransform.translation = { 0.f, 0.f, -0.0002f };
-                        optimalPathTransform.scale = glm::vec3{ 1.f, 1.f, 1.f };
-                        ecs.addComponent<ModelComponent>(optimalPath, { model });
-                        ecs.addComponent<TransformComponent>(optimalPath, optimalPathTransform);
-                        ecs.addComponent<OptimalComponent>(optimalPath, { });
-                    }
+                if (result.partial) {
+                    solution.endTimestamp = animationStart;
+                    continue;
+                }
 
-                    solution.endTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+                pendingQuery.reset();
+                solution = std::move(result.solution);
+
+                if (optimalPathCreated) {
+                    ecs.destroyEntity(optimalPath);
+                    optimalPathCreated = false;
+                }
+                if (solution.path.size() > 0) {
+                    // create optimal path model
+                    model = std::make_shared<Model>(device, result.path);
+                    optimalPath = ecs.createEntity();
+                    optimalPathCreated = true;
+                    TransformComponent optimalPathTransform{};
+                    optimalPathTransform.translation = { 0.f, 0.f, -0.0002f };
+                    optimalPathTransform.scale = glm::vec3{ 1.f, 1.f, 1.f };
+                    ecs.addComponent<ModelComponent>(optimalPath, { model });
+                    ecs.addComponent<TransformComponent>(optimalPath, optimalPathTransform);
+                    ecs.addComponent<OptimalComponent>(optimalPath, { });
                 }
+
+                solution.endTimestamp = animationStart;
             }
 
             spatialSystemManager.update(frameInfo, ubo);
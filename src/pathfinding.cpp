@@ -1,137 +1,418 @@
 #include "pathfinding.h"
 
+#include "Landmarks.h"
+#include "SearchContext.h"
+#include "SearchHelpers.h"
+#include "TrafficProfiles.h"
+
+#include <algorithm>
+#include <cfloat>
 #include <queue>
-#include <chrono>
-#include <unordered_set>
 #include <iostream>
-#include <set>
 
-PathfindingSolution pathfinding::dijkstra(MapGraph& graph, Node* from, Node* to) {
-    const auto beginTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+namespace {
+    using pathfinding::currentTimestamp;
+    using pathfinding::currentNanoseconds;
+    using pathfinding::ZeroPotential;
+    using pathfinding::EuclideanPotential;
 
-    // data structures
-    std::vector<Edge*> predecessor(graph.nodes.size(), nullptr);
-    std::vector<double> distance(graph.nodes.size(), DBL_MAX);
-    distance[from->id] = 0.0;
+    // a lower bound on travel time: straight-line distance times the fastest pace anywhere in the network
+    struct ScaledPotential {
+        EuclideanPotential distance;
+        double scale;
 
-    // initialize
-    std::set<std::pair<double, Node*>> todo;
-    for (auto& node : graph.nodes) {
-        todo.insert({ distance[node->id], node });
-    }
+        double operator()(uint32_t node) const { return distance(node) * scale; }
+    };
 
-    // record all checked edges
-    std::vector<Edge*> checked{};
-    std::unordered_set<Edge*> checkedSet{};
-    checked.reserve(graph.edges.size());
-    checkedSet.reserve(graph.edges.size());
-
-    while (!todo.empty()) {
-        Node* v = todo.begin()->second;
-        todo.erase(todo.begin());
-
-        for (auto& edge : graph.adjacencyList[v]) {
-            Node* toNode = edge->to;
-            double newDist = distance[v->id] + edge->weight;
-
-            // edge relaxation
-            if (newDist < distance[toNode->id]) {
-                todo.erase({ distance[toNode->id], toNode });
-                distance[toNode->id] = newDist;
-                predecessor[toNode->id] = edge;
-                todo.insert({ newDist, toNode });
+    // edge costs for the label-setting search, given the label of the edge's source
+    struct StaticCost {
+        const double* weights;
+
+        double operator()(uint32_t edge, double /*label*/) const { return weights[edge]; }
+    };
+
+    // labels are seconds since departure; an edge costs its travel time at the moment it is entered
+    struct TimeDependentCost {
+        const TrafficProfiles& profiles;
+        double departure;
+
+        double operator()(uint32_t edge, double label) const { return profiles.travelTime(edge, departure + label); }
+    };
+
+    // average of the forward and backward estimates, so that the forward potential p(v) and the
+    // backward potential -p(v) are consistent at the same time (Ikeda et al.)
+    template <typename Potential>
+    struct AveragePotential {
+        Potential toTarget;
+        Potential toSource;
+
+        double operator()(uint32_t node) const { return (toTarget(node) - toSource(node)) * 0.5; }
+    };
+
+    // label-setting search from "from" over the CSR graph, templated on the priority queue backend,
+    // the node potential (zero for Dijkstra, a distance estimate to the target for A*) and the edge cost
+    // (static weights, or travel times that depend on the label for time-dependent searches).
+    // only the source is queued initially; nodes enter the queue when first reached.
+    // when target is not UINT32_MAX the search stops as soon as the target is settled.
+    // checked may be nullptr to skip recording scanned edges, control nullptr to run uninterrupted.
+    template <typename Queue, typename Potential, typename Cost>
+    void labelSettingSearch(MapGraph& graph, uint32_t from, uint32_t target, SearchContext& context, const Potential& potential, const Cost& cost,
+        std::vector<Edge*>* checked, const SearchControl* control, SearchStats& stats) {
+        // CSR views
+        const uint32_t* offsets = graph.offsets.data();
+        const uint32_t* targets = graph.targets.data();
+
+        Queue& todo = context.queue<Queue>();
+        context.update(from, 0.0, UINT32_MAX);
+        todo.push(from, potential(from));
+
+        while (!todo.empty()) {
+            const pathfinding::QueueEntry top = todo.pop();
+            const uint32_t v = top.node;
+            if (context.settled(v)) continue; // stale entry left behind by lazy deletion
+            context.settle(v);
+            stats.settledNodes++;
+            if (v == target) break;
+            if (control && stats.settledNodes % SearchControl::CHECKPOINT_INTERVAL == 0 && control->checkpoint(checked)) break;
+
+            stats.relaxedEdges += offsets[v + 1] - offsets[v];
+            const double distV = context.distance(v);
+            for (uint32_t slot = offsets[v]; slot < offsets[v + 1]; slot++) {
+                const uint32_t toNode = targets[slot];
+                double newDist = distV + cost(slot, distV);
+
+                // edge relaxation
+                if (newDist < context.distance(toNode)) {
+                    context.update(toNode, newDist, slot);
+                    // keys never drop below the current minimum; guards monotone queues against rounding
+                    todo.push(toNode, std::max(newDist + potential(toNode), top.key));
+                }
+
+                // record all checked edges
+                if (checked && context.markEdge(slot))
+                    checked->push_back(graph.edges[slot]);
             }
+        }
+    }
+
+    template <typename Potential, typename Cost>
+    void labelSettingSearch(MapGraph& graph, uint32_t from, uint32_t target, pathfinding::QueueType queue, SearchContext& context, const Potential& potential,
+        const Cost& cost, std::vector<Edge*>* checked, const SearchControl* control, SearchStats& stats) {
+        switch (queue) {
+        case pathfinding::QueueType::QuaternaryHeap:
+            labelSettingSearch<pathfinding::QuaternaryHeap>(graph, from, target, context, potential, cost, checked, control, stats);
+            break;
+        case pathfinding::QueueType::RadixHeap:
+            labelSettingSearch<pathfinding::RadixHeap>(graph, from, target, context, potential, cost, checked, control, stats);
+            break;
+        default:
+            labelSettingSearch<pathfinding::BinaryHeap>(graph, from, target, context, potential, cost, checked, control, stats);
+            break;
+        }
+    }
+
+    // one half of a bidirectional search. the forward half walks the CSR arrays, the backward half walks
+    // the reverse adjacency, where each slot maps back to the id of the original edge.
+    template <typename Queue>
+    struct SearchDirection {
+        const uint32_t* offsets;
+        const uint32_t* adjacent; // neighbor reached through each slot
+        const uint32_t* edgeIds;  // edge id of each slot, or nullptr when slots are edge ids
+        double potentialSign;     // forward searches use p(v), backward searches -p(v)
+        SearchContext::Handle context; // labels; predecessors are edge ids used to reach each node from this side's root
+        Queue& queue;
 
-            // record all checked edges
-            if (checkedSet.find(edge) == checkedSet.end()) {
-                checked.push_back(edge);
-                checkedSet.insert(edge);
+        SearchDirection(const uint32_t* offsets, const uint32_t* adjacent, const uint32_t* edgeIds, double potentialSign, size_t nodeCount, size_t edgeCount)
+            : offsets{ offsets }, adjacent{ adjacent }, edgeIds{ edgeIds }, potentialSign{ potentialSign },
+            context{ SearchContext::acquire(nodeCount, edgeCount) }, queue{ context->queue<Queue>() } {}
+    };
+
+    // alternates between the two frontiers, always expanding the side with the smaller queue minimum,
+    // and stops once the two minimums together cannot beat the best meeting found so far.
+    // queue keys are reduced distances d(v) + p(v) - p(root) on each side, which are non-negative for a
+    // consistent potential; with p = 0 this is plain bidirectional Dijkstra.
+    // returns the meeting node of the shortest path, or UINT32_MAX if the nodes are not connected.
+    // scanned edges are marked in the forward context so an edge seen from both ends is recorded once.
+    template <typename Queue, typename Potential>
+    uint32_t bidirectionalSearch(MapGraph& graph, uint32_t source, uint32_t target, SearchDirection<Queue>& forward, SearchDirection<Queue>& backward,
+        const Potential& potential, std::vector<Edge*>* checked, const SearchControl* control, SearchStats& stats) {
+        const double* weights = graph.weights.data();
+
+        forward.context->update(source, 0.0, UINT32_MAX);
+        backward.context->update(target, 0.0, UINT32_MAX);
+        forward.queue.push(source, 0.0);
+        backward.queue.push(target, 0.0);
+
+        if (source == target) return source;
+
+        // reduced keys shift the stopping criterion by the potentials of the two roots
+        const double sourcePotential = potential(source);
+        const double targetPotential = potential(target);
+        const double criterionOffset = targetPotential - sourcePotential;
+
+        double best = DBL_MAX;
+        uint32_t meeting = UINT32_MAX;
+        while (!forward.queue.empty() && !backward.queue.empty()) {
+            const double forwardMin = forward.queue.top().key;
+            const double backwardMin = backward.queue.top().key;
+            if (best != DBL_MAX && forwardMin + backwardMin >= best + criterionOffset) break;
+
+            SearchDirection<Queue>& side = forwardMin <= backwardMin ? forward : backward;
+            SearchDirection<Queue>& other = forwardMin <= backwardMin ? backward : forward;
+            const double rootPotential = &side == &forward ? sourcePotential : -targetPotential;
+
+            const pathfinding::QueueEntry top = side.queue.pop();
+            const uint32_t v = top.node;
+            if (side.context->settled(v)) continue; // stale entry left behind by lazy deletion
+            side.context->settle(v);
+            stats.settledNodes++;
+            if (control && stats.settledNodes % SearchControl::CHECKPOINT_INTERVAL == 0 && control->checkpoint(checked)) break;
+            stats.relaxedEdges += side.offsets[v + 1] - side.offsets[v];
+
+            const double distV = side.context->distance(v);
+            for (uint32_t slot = side.offsets[v]; slot < side.offsets[v + 1]; slot++) {
+                const uint32_t w = side.adjacent[slot];
+                const uint32_t edgeId = side.edgeIds ? side.edgeIds[slot] : slot;
+                const double newDist = distV + weights[edgeId];
+
+                // edge relaxation
+                if (newDist < side.context->distance(w)) {
+                    side.context->update(w, newDist, edgeId);
+                    const double key = newDist + side.potentialSign * potential(w) - rootPotential;
+                    side.queue.push(w, std::max(key, top.key));
+                }
+
+                // meeting criterion; w has been reached from both ends
+                const double otherDist = other.context->distance(w);
+                if (otherDist != DBL_MAX && side.context->distance(w) + otherDist < best) {
+                    best = side.context->distance(w) + otherDist;
+                    meeting = w;
+                }
+
+                // record all checked edges
+                if (checked && forward.context->markEdge(edgeId))
+                    checked->push_back(graph.edges[edgeId]);
             }
         }
+
+        return meeting;
     }
 
-    const auto endTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+    template <typename Queue, typename Potential>
+    PathfindingSolution runBidirectionalSearch(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options, const Potential& potential, long long beginTimestamp) {
+        const size_t markedEdges = options.recordChecked ? graph.edgeCount() : 0;
+        SearchDirection<Queue> forward{ graph.offsets.data(), graph.targets.data(), nullptr, 1.0, graph.nodeCount(), markedEdges };
+        SearchDirection<Queue> backward{ graph.reverseOffsets.data(), graph.reverseSources.data(), graph.reverseEdges.data(), -1.0, graph.nodeCount(), 0 };
 
-    if (predecessor[to->id] == nullptr) return { checked, {}, beginTimestamp, endTimestamp };
+        // record all checked edges
+        std::vector<Edge*> checked{};
 
-    // construct optimal path
-    std::vector<Edge*> path;
-    for (Node* current = to; current != from; current = predecessor[current->id]->from) {
-        path.push_back(predecessor[current->id]);
+        SearchStats stats{};
+        const long long beginNanoseconds = currentNanoseconds();
+        const uint32_t meeting = bidirectionalSearch(graph, static_cast<uint32_t>(from->id), static_cast<uint32_t>(to->id), forward, backward, potential,
+            options.recordChecked ? &checked : nullptr, options.control, stats);
+        stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+        const auto endTimestamp = currentTimestamp();
+
+        if (options.control && options.control->isCancelled()) return { checked, {}, beginTimestamp, endTimestamp, stats, true };
+
+        if (meeting == UINT32_MAX) return { checked, {}, beginTimestamp, endTimestamp, stats };
+
+        // construct optimal path; forward tree from the meeting node back to "from", then backward tree on to "to"
+        std::vector<Edge*> path;
+        for (uint32_t current = meeting; current != from->id; current = graph.sources[forward.context->predecessor(current)]) {
+            path.push_back(graph.edges[forward.context->predecessor(current)]);
+        }
+        std::reverse(path.begin(), path.end());
+        for (uint32_t current = meeting; current != to->id; current = graph.targets[backward.context->predecessor(current)]) {
+            path.push_back(graph.edges[backward.context->predecessor(current)]);
+        }
+
+        return { checked, path, beginTimestamp, endTimestamp, stats };
     }
 
-    std::reverse(path.begin(), path.end());
+    template <typename Potential>
+    PathfindingSolution runBidirectionalSearch(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options, const Potential& potential) {
+        const auto beginTimestamp = currentTimestamp();
+
+        switch (options.queue) {
+        case pathfinding::QueueType::QuaternaryHeap:
+            return runBidirectionalSearch<pathfinding::QuaternaryHeap>(graph, from, to, options, potential, beginTimestamp);
+        case pathfinding::QueueType::RadixHeap:
+            return runBidirectionalSearch<pathfinding::RadixHeap>(graph, from, to, options, potential, beginTimestamp);
+        default:
+            return runBidirectionalSearch<pathfinding::BinaryHeap>(graph, from, to, options, potential, beginTimestamp);
+        }
+    }
+
+    // unidirectional searches share setup and path construction
+    template <typename Potential, typename Cost>
+    PathfindingSolution runSearch(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options, const Potential& potential, const Cost& cost) {
+        const auto beginTimestamp = currentTimestamp();
+
+        // labels; reused between queries on this thread
+        SearchContext::Handle context = SearchContext::acquire(graph.nodeCount(), options.recordChecked ? graph.edgeCount() : 0);
+
+        // record all checked edges
+        std::vector<Edge*> checked{};
+
+        SearchStats stats{};
+        const long long beginNanoseconds = currentNanoseconds();
+        const uint32_t target = options.stopAtTarget ? static_cast<uint32_t>(to->id) : UINT32_MAX;
+        labelSettingSearch(graph, static_cast<uint32_t>(from->id), target, options.queue, *context, potential, cost,
+            options.recordChecked ? &checked : nullptr, options.control, stats);
+        stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+
+        const auto endTimestamp = currentTimestamp();
 
-    return { checked, path, beginTimestamp, endTimestamp };
+        if (options.control && options.control->isCancelled()) return { checked, {}, beginTimestamp, endTimestamp, stats, true };
+
+        if (context->predecessor(static_cast<uint32_t>(to->id)) == UINT32_MAX) return { checked, {}, beginTimestamp, endTimestamp, stats };
+
+        // construct optimal path
+        std::vector<Edge*> path;
+        for (Node* current = to; current != from; current = graph.edges[context->predecessor(static_cast<uint32_t>(current->id))]->from) {
+            path.push_back(graph.edges[context->predecessor(static_cast<uint32_t>(current->id))]);
+        }
+
+        std::reverse(path.begin(), path.end());
+
+        return { checked, path, beginTimestamp, endTimestamp, stats };
+    }
 }
 
-PathfindingSolution pathfinding::bellmanford(MapGraph& graph, Node* from, Node* to) {
-    const auto beginTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+PathfindingSolution pathfinding::dijkstra(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options) {
+    return runSearch(graph, from, to, options, ZeroPotential{}, StaticCost{ graph.weights.data() });
+}
 
-    // data structures
-    std::vector<Edge*> predecessor(graph.nodes.size(), nullptr);
-    std::vector<double> distance(graph.nodes.size(), DBL_MAX);
-    distance[from->id] = 0.0;
+PathfindingSolution pathfinding::bidirectionalDijkstra(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options) {
+    return runBidirectionalSearch(graph, from, to, options, ZeroPotential{});
+}
 
-    // record all checked edges
-    std::vector<Edge*> checked{};
-    std::unordered_set<Edge*> checkedSet{};
-    checked.reserve(graph.edges.size());
-    checkedSet.reserve(graph.edges.size());
+PathfindingSolution pathfinding::astar(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options) {
+    // the potential only pays off when the search stops at the target
+    PathfindingOptions targeted = options;
+    targeted.stopAtTarget = true;
+    return runSearch(graph, from, to, targeted, EuclideanPotential{ graph, static_cast<uint32_t>(to->id) }, StaticCost{ graph.weights.data() });
+}
 
+PathfindingSolution pathfinding::bidirectionalAstar(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options) {
+    const AveragePotential<EuclideanPotential> potential{
+        EuclideanPotential{ graph, static_cast<uint32_t>(to->id) },
+        EuclideanPotential{ graph, static_cast<uint32_t>(from->id) } };
+    return runBidirectionalSearch(graph, from, to, options, potential);
+}
+
+PathfindingSolution pathfinding::alt(MapGraph& graph, const Landmarks& landmarks, Node* from, Node* to, const PathfindingOptions& options) {
+    PathfindingOptions targeted = options;
+    targeted.stopAtTarget = true;
+    return runSearch(graph, from, to, targeted, landmarks.potentialTo(static_cast<uint32_t>(to->id)), StaticCost{ graph.weights.data() });
+}
+
+PathfindingSolution pathfinding::bidirectionalAlt(MapGraph& graph, const Landmarks& landmarks, Node* from, Node* to, const PathfindingOptions& options) {
+    const AveragePotential<Landmarks::Potential> potential{
+        landmarks.potentialTo(static_cast<uint32_t>(to->id)),
+        landmarks.potentialFrom(static_cast<uint32_t>(from->id)) };
+    return runBidirectionalSearch(graph, from, to, options, potential);
+}
+
+PathfindingSolution pathfinding::timeDependentDijkstra(MapGraph& graph, const TrafficProfiles& profiles, Node* from, Node* to, double departure,
+    const PathfindingOptions& options) {
+    return runSearch(graph, from, to, options, ZeroPotential{}, TimeDependentCost{ profiles, departure });
+}
+
+PathfindingSolution pathfinding::timeDependentAstar(MapGraph& graph, const TrafficProfiles& profiles, Node* from, Node* to, double departure,
+    const PathfindingOptions& options) {
+    PathfindingOptions targeted = options;
+    targeted.stopAtTarget = true;
+    const ScaledPotential potential{ EuclideanPotential{ graph, static_cast<uint32_t>(to->id) }, profiles.minimumPace() };
+    return runSearch(graph, from, to, targeted, potential, TimeDependentCost{ profiles, departure });
+}
+
+PathfindingSolution pathfinding::bellmanford(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options) {
+    const auto beginTimestamp = currentTimestamp();
 
-    // relaxation across all edges
+    // CSR views
+    const uint32_t* offsets = graph.offsets.data();
+    const uint32_t* targets = graph.targets.data();
+    const double* weights = graph.weights.data();
+
+    // labels; reused between queries on this thread
+    SearchContext::Handle context = SearchContext::acquire(graph.nodeCount());
+    context->update(static_cast<uint32_t>(from->id), 0.0, UINT32_MAX);
+
+    SearchStats stats{};
+    const long long beginNanoseconds = currentNanoseconds();
+
+    // progress: the edges relaxed so far, i.e. those out of the nodes reached so far, in the order they
+    // were first relaxed
+    const bool reportProgress = options.recordChecked && options.control;
+    std::vector<Edge*> relaxed{};
+    std::vector<bool> reached(reportProgress ? graph.nodeCount() : 0, false);
+
+    // relaxation across all edges, walked source by source so distance[u] is loaded once per node
     bool updated;
-    for (size_t i = 0; i < graph.nodes.size() - 1; ++i) {
+    for (size_t i = 0; i < graph.nodeCount() - 1; ++i) {
         updated = false;
-        for (auto& edge : graph.edges) {
-            Node* u = edge->from;
-            Node* v = edge->to;
-            double weight = edge->weight;
-
-            if (distance[u->id] != DBL_MAX && distance[u->id] + weight < distance[v->id]) {
-                distance[v->id] = distance[u->id] + weight;
-                predecessor[v->id] = edge;
-                updated = true;
+        stats.settledNodes += graph.nodeCount();
+        stats.relaxedEdges += graph.edgeCount();
+        for (uint32_t u = 0; u < graph.nodeCount(); u++) {
+            const double distU = context->distance(u);
+            if (distU == DBL_MAX) continue;
+            if (reportProgress && !reached[u]) {
+                reached[u] = true;
+                for (uint32_t slot = offsets[u]; slot < offsets[u + 1]; slot++)
+                    relaxed.push_back(graph.edges[slot]);
             }
+            for (uint32_t slot = offsets[u]; slot < offsets[u + 1]; slot++) {
+                const uint32_t v = targets[slot];
 
-            if (checkedSet.find(edge) == checkedSet.end()) {
-                checked.push_back(edge);
-                checkedSet.insert(edge);
+                if (distU + weights[slot] < context->distance(v)) {
+                    context->update(v, distU + weights[slot], slot);
+                    updated = true;
+                }
             }
         }
         if (!updated) break;
+
+        // rounds are the checkpoints
+        if (options.control && options.control->checkpoint(reportProgress ? &relaxed : nullptr)) {
+            stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+            return { {}, {}, beginTimestamp, currentTimestamp(), stats, true };
+        }
     }
 
+    // every round sweeps every edge, in slot order
+    std::vector<Edge*> checked{};
+    if (options.recordChecked)
+        checked.assign(graph.edges.begin(), graph.edges.end());
+
     // check for infinite loop
-    for (auto& edge : graph.edges) {
-        Node* u = edge->from;
-        Node* v = edge->to;
-        double weight = edge->weight;
-
-        if (distance[u->id] != DBL_MAX && distance[u->id] + weight < distance[v->id]) {
-            return { checked, {}, beginTimestamp, std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()).count() };
+    for (uint32_t u = 0; u < graph.nodeCount(); u++) {
+        for (uint32_t slot = offsets[u]; slot < offsets[u + 1]; slot++) {
+            if (context->distance(u) != DBL_MAX && context->distance(u) + weights[slot] < context->distance(targets[slot])) {
+                stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+                return { checked, {}, beginTimestamp, currentTimestamp(), stats };
+            }
         }
     }
 
-    const auto endTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+    stats.nanoseconds = currentNanoseconds() - beginNanoseconds;
+    const auto endTimestamp = currentTimestamp();
 
-    if (predecessor[to->id] == nullptr) return { checked, {}, beginTimestamp, endTimestamp };
+    if (context->predecessor(static_cast<uint32_t>(to->id)) == UINT32_MAX) return { checked, {}, beginTimestamp, endTimestamp, stats };
 
     // construct optimal path
     std::vector<Edge*> path;
-    for (Node* current = to; current != from && predecessor[current->id] != nullptr; current = predecessor[current->id]->from) {
-        path.push_back(predecessor[current->id]);
+    for (Node* current = to; current != from && context->predecessor(static_cast<uint32_t>(current->id)) != UINT32_MAX;
+        current = graph.edges[context->predecessor(static_cast<uint32_t>(current->id))]->from) {
+        path.push_back(graph.edges[context->predecessor(static_cast<uint32_t>(current->id))]);
     }
 
-    if (path.empty() && from != to) return { checked, {}, beginTimestamp, endTimestamp };
+    if (path.empty() && from != to) return { checked, {}, beginTimestamp, endTimestamp, stats };
 
     std::reverse(path.begin(), path.end());
 
-    return { checked, path, beginTimestamp, endTimestamp };
+    return { checked, path, beginTimestamp, endTimestamp, stats };
 }
@@ -1,18 +1,129 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <atomic>
+#include <functional>
 #include <vector>
 
 #include "MapGraph.h"
+#include "PriorityQueue.h"
+
+// search effort, filled in by every algorithm for benchmarking
+struct SearchStats {
+	size_t settledNodes = 0; // nodes whose outgoing edges were scanned (once per round for Bellman-Ford)
+	size_t relaxedEdges = 0; // edges scanned, counting repeats
+	long long nanoseconds = 0; // steady clock time of the search, excluding building checked/path vectors where possible
+};
 
 struct PathfindingSolution {
 	std::vector<Edge*> checked;
 	std::vector<Edge*> path;
 	long long beginTimestamp;
 	long long endTimestamp;
+	SearchStats stats{};
+	bool cancelled = false; // stopped through SearchControl::cancel; checked holds what was scanned until then
+	std::vector<std::vector<Edge*>> alternatives{}; // routes besides path, best first; only the alternative route searches fill it
+	std::vector<std::vector<glm::vec2>> boundaries{}; // outlines of a reached area; only isochrone queries fill it
+};
+
+// one-to-all result; predecessor holds the edge id used to reach each node (UINT32_MAX if unreached)
+struct ShortestPathTree {
+	std::vector<double> distance;
+	std::vector<uint32_t> predecessor;
+	SearchStats stats{};
+};
+
+// extra cost of each kind of turn for the edge-based searches, in edge weight units. by default turns are
+// free and only the turn restrictions apply
+struct TurnCosts {
+	double straight = 0.0;
+	double right = 0.0;
+	double left = 0.0;
+	double uTurn = 0.0;
+};
+
+class Landmarks;
+class ThreadPool;
+class TrafficProfiles;
+
+// cooperative cancellation and progress reporting for a running search. searches call checkpoint every
+// CHECKPOINT_INTERVAL settled nodes (every round or bucket for the Bellman-Ford and delta-stepping variants)
+// and return early once cancel has been called.
+class SearchControl {
+public:
+	static constexpr size_t CHECKPOINT_INTERVAL = 1024;
+
+	// any thread
+	void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+	bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+	// reports progress on the searching thread; returns true if the search should stop.
+	// checked is nullptr when the search does not record checked edges
+	bool checkpoint(const std::vector<Edge*>* checked) const {
+		if (checked && onProgress) onProgress(*checked);
+		return isCancelled();
+	}
+
+	// receives everything checked so far, in order; runs on the searching thread while the search waits
+	std::function<void(const std::vector<Edge*>& checked)> onProgress{};
+private:
+	std::atomic<bool> cancelled{ false };
+};
+
+struct PathfindingOptions {
+	pathfinding::QueueType queue = pathfinding::QueueType::BinaryHeap;
+	bool stopAtTarget = false; // stop once "to" is settled instead of exploring the whole graph (dijkstra only)
+	bool recordChecked = true; // fill PathfindingSolution::checked; batch queries that never draw it can skip the bookkeeping
+	SearchControl* control = nullptr; // optional cancellation and progress reporting
 };
 
 namespace pathfinding {
-	PathfindingSolution dijkstra(MapGraph& graph, Node* from, Node* to);
-	PathfindingSolution bellmanford(MapGraph& graph, Node* from, Node* to);
-}
\ No newline at end of file
+	PathfindingSolution dijkstra(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options = {});
+	PathfindingSolution bidirectionalDijkstra(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options = {});
+	PathfindingSolution astar(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options = {});
+	PathfindingSolution bidirectionalAstar(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options = {});
+	PathfindingSolution bellmanford(MapGraph& graph, Node* from, Node* to, const PathfindingOptions& options = {});
+
+	// A* directed by landmark lower bounds instead of the straight-line distance, so the weights need not be
+	// euclidean; valid as long as no weight dropped below the one the landmark tables were built from
+	PathfindingSolution alt(MapGraph& graph, const Landmarks& landmarks, Node* from, Node* to, const PathfindingOptions& options = {});
+	PathfindingSolution bidirectionalAlt(MapGraph& graph, const Landmarks& landmarks, Node* from, Node* to, const PathfindingOptions& options = {});
+
+	// fastest route when leaving at "departure" (seconds since midnight) under the traffic profiles, which must be
+	// bound to the graph; TrafficProfiles::pathTravelTime gives the travel time of the resulting path
+	PathfindingSolution timeDependentDijkstra(MapGraph& graph, const TrafficProfiles& profiles, Node* from, Node* to, double departure,
+		const PathfindingOptions& options = {});
+	PathfindingSolution timeDependentAstar(MapGraph& graph, const TrafficProfiles& profiles, Node* from, Node* to, double departure,
+		const PathfindingOptions& options = {});
+
+	// edge-based searches (EdgeBasedPathfinding.cpp), which obey turn restrictions and charge turn costs. a search
+	// state is an edge, reached at its head node; its successors are the turns the head node's turn table
+	// allows, so the line graph is expanded on the fly and never built. stats count settled edges as nodes
+	PathfindingSolution edgeBasedDijkstra(MapGraph& graph, Node* from, Node* to, const TurnCosts& costs = {}, const PathfindingOptions& options = {});
+	PathfindingSolution edgeBasedAstar(MapGraph& graph, Node* from, Node* to, const TurnCosts& costs = {}, const PathfindingOptions& options = {});
+
+	// several routes between two nodes (AlternativeRoutes.cpp): path is the shortest one and alternatives hold
+	// the others, best first. options.queue and options.stopAtTarget are ignored
+
+	// the k shortest loopless paths (Yen). every spur search is A* directed by one backward shortest path tree
+	// of "to", an exact bound in the graph the spur searches remove edges from, and spur nodes before the
+	// point where a path branched off its parent are skipped (Lawler)
+	PathfindingSolution kShortestPaths(MapGraph& graph, Node* from, Node* to, size_t k, const PathfindingOptions& options = {});
+
+	// up to maxAlternatives via-node routes (Abraham et al.), each the shortest path to a via node joined to the
+	// shortest path on from it, read off one forward and one backward search. via nodes are ranked by the
+	// plateau they lie on, the stretch of road both searches agree on; a route is accepted if it is not much
+	// longer than the shortest path, shares little with the routes before it and is locally optimal
+	PathfindingSolution alternativeRoutes(MapGraph& graph, Node* from, Node* to, size_t maxAlternatives = 3, const PathfindingOptions& options = {});
+
+	// multi-threaded one-to-all searches (ParallelPathfinding.cpp)
+	// a cancelled tree search returns the distances reached so far and no predecessors. with relaxed, the tree
+	// searches collect the edges out of every node reached, a round (or bucket) at a time, and publish them
+	// through the control's checkpoint. within a round or bucket they come in no particular order
+	ShortestPathTree parallelBellmanfordTree(MapGraph& graph, uint32_t source, ThreadPool& pool, const SearchControl* control = nullptr,
+		std::vector<Edge*>* relaxed = nullptr);
+	ShortestPathTree deltaSteppingTree(MapGraph& graph, uint32_t source, ThreadPool& pool, double delta = 0.0, const SearchControl* control = nullptr,
+		std::vector<Edge*>* relaxed = nullptr); // delta == 0 picks one from the edge weights
+	PathfindingSolution parallelBellmanford(MapGraph& graph, Node* from, Node* to, ThreadPool& pool, const PathfindingOptions& options = {});
+	PathfindingSolution deltaStepping(MapGraph& graph, Node* from, Node* to, ThreadPool& pool, double delta = 0.0, const PathfindingOptions& options = {});
+}